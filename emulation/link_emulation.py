@@ -7,6 +7,8 @@ import time
 import subprocess
 import datetime
 import json
+import mmap
+import struct
 
 from typing import Optional, Dict, List
 from dataclasses import dataclass
@@ -23,7 +25,14 @@ route            = route id [id]
 """
 
 MIN_UPDATE_MS = 100
-DEFAULT_HEADER = "at,delay,stddev,min_link_cap,max_link_cap,queue_capacity,hops,dropratio"
+DEFAULT_HEADER = "at,delay,stddev,min_link_cap,max_link_cap,queue_capacity,hops,dropratio,route"
+REQUIRED_COLUMNS = ["at", "delay", "stddev", "min_link_cap", "queue_capacity", "hops", "dropratio", "route"]
+
+# Binary trace files, see simulation/overlay/src/applications/model/trace-file.h
+TRACE_FILE_MAGIC = b"NSTRACE\0"
+TRACE_FILE_VERSION = 1
+TRACE_FILE_HEADER = struct.Struct("<8sHHIIIQQQQQ")
+TRACE_FILE_COLUMN = struct.Struct("<24sB7x")
 TC_EXEC = "/usr/sbin/tc"
 IPTABLES_EXEC = "/usr/sbin/iptables"
 IP_EXEC = "/usr/sbin/ip"
@@ -64,17 +73,10 @@ class TraceFileEntry:
     def __str__(self) -> str:
         return f"At t={self.time}: Rate={self.rate}, Delay={self.delay}, Hops={self.hops}, Queue={self.queue_cap}"
 
-    def parse_line(self, line: str) -> bool:
-        parts = line.split(",")
-        if len(parts) != 8:
-            return False
-
-        at, delay, stddev, min_link_cap, _, queue_cap, hops, drop, route_id = parts
-        min_link_cap = int(float(min_link_cap))
-
+    def parse_values(self, at, delay, stddev, min_link_cap, queue_cap, hops, drop, route_id) -> bool:
         try:
             self.time = int(at) // 1000 # µs to ms
-            self.rate = min_link_cap
+            self.rate = int(float(min_link_cap))
             self.delay = int(float(delay) // 1000) # µs to ms
             self.jitter = int(float(stddev) // 1000) # µs to ms
             self.loss = float(drop) * 100 # 0-1 to %
@@ -87,14 +89,79 @@ class TraceFileEntry:
 
         return True
 
+    def parse_line(self, line: str, columns: Dict[str, int]) -> bool:
+        parts = line.split(",")
+        if len(parts) != len(columns):
+            return False
+
+        return self.parse_values(*[parts[columns[name]] for name in REQUIRED_COLUMNS])
+
 
 def check_interface_exists(interface_name: str) -> bool:
     interfaces = psutil.net_if_addrs()
     return interface_name in interfaces
 
 
+def get_column_indexes(names: List[str]) -> Optional[Dict[str, int]]:
+    columns = {name: index for index, name in enumerate(names)}
+    if any(name not in columns for name in REQUIRED_COLUMNS):
+        return None
+    return columns
+
+
+def load_and_parse_binary_trace(trace_file_name: str, iface_name: str) -> Optional[Dict[int, TraceFileEntry]]:
+    result = {}
+    try:
+        with open(trace_file_name, "rb") as handle, \
+             mmap.mmap(handle.fileno(), 0, access=mmap.ACCESS_READ) as data:
+            _, version, column_count, row_size, _, _, _, data_offset, row_count, routes_offset, _ = \
+                TRACE_FILE_HEADER.unpack_from(data, 0)
+
+            if version != TRACE_FILE_VERSION or routes_offset == 0:
+                print(f"Unable to parse file '{trace_file_name}': Unsupported version or file not closed.", file=sys.stderr)
+                return None
+
+            names = []
+            row_format = "<"
+            for index in range(column_count):
+                name, kind = TRACE_FILE_COLUMN.unpack_from(data, TRACE_FILE_HEADER.size + index * TRACE_FILE_COLUMN.size)
+                if b"\0" not in name or kind not in (0, 1):
+                    print(f"Unable to parse file '{trace_file_name}': Malformed column {index}.", file=sys.stderr)
+                    return None
+                names.append(name[:name.index(b"\0")].decode("ascii"))
+                row_format += "Q" if kind == 0 else "d"
+
+            columns = get_column_indexes(names)
+            if columns is None or struct.calcsize(row_format) != row_size:
+                print(f"Unable to parse file '{trace_file_name}': Unexpected schema {names}.", file=sys.stderr)
+                return None
+
+            rows = data[data_offset:data_offset + row_count * row_size]
+            for rowcount, row in enumerate(struct.iter_unpack(row_format, rows), start=1):
+                elem = TraceFileEntry(iface_name)
+                if not elem.parse_values(*[row[columns[name]] for name in REQUIRED_COLUMNS]):
+                    print(f"Unable to parse file '{trace_file_name}': Parsing error in row {rowcount}.", file=sys.stderr)
+                    return None
+
+                result[elem.time] = elem
+    except Exception as ex:
+        print(f"Unable to read trace file '{trace_file_name}': {ex}", file=sys.stderr)
+        return None
+
+    return result
+
+
 def load_and_parse_trace(trace_file_name: str, iface_name: str) -> Optional[Dict[int, TraceFileEntry]]:
+    try:
+        with open(trace_file_name, "rb") as handle:
+            if handle.read(len(TRACE_FILE_MAGIC)) == TRACE_FILE_MAGIC:
+                return load_and_parse_binary_trace(trace_file_name, iface_name)
+    except Exception as ex:
+        print(f"Unable to read trace file '{trace_file_name}': {ex}", file=sys.stderr)
+        return None
+
     result = {}
+    columns = get_column_indexes(DEFAULT_HEADER.split(","))
     try:
         with open(trace_file_name, "r") as handle:
             lines = handle.readlines()
@@ -103,14 +170,18 @@ def load_and_parse_trace(trace_file_name: str, iface_name: str) -> Optional[Dict
             for line in lines:
                 linecount += 1
                 line = ''.join(line.split())
-                if line == DEFAULT_HEADER:
+                if line.startswith("at,"):
+                    columns = get_column_indexes(line.split(","))
+                    if columns is None:
+                        print(f"Unable to parse file '{trace_file_name}': Missing columns in header.", file=sys.stderr)
+                        return None
                     continue
 
                 if line == "":
                     continue
                 
                 elem = TraceFileEntry(iface_name)
-                if not elem.parse_line(line):
+                if not elem.parse_line(line, columns):
                     print(f"Unable to parse file '{trace_file_name}': Parsing error in line {linecount}.", file=sys.stderr)
                     return None
                 
@@ -16,30 +16,35 @@ def load_sinle_series(basepath,  offset = 0):
     series = []
 
     for file in os.listdir(basepath):
-        if not file.endswith(".csv"):
+        if not file.endswith(".csv") or file == "index.csv":
             continue
         
         df = pd.read_csv(os.path.join(basepath, file))
-        df = df[df["receive_time"] != 0]
-        df = df.sort_values(by="receive_time")
+        # Merged replication results hold one run per seed.
+        runs = [run for _, run in df.groupby("seed")] if "seed" in df.columns else [df]
+        for df in runs:
+            mean = bitrate_mean(df, offset)
+            if math.isnan(mean):
+                print(f"Warning: File {file} contains NaN bitrate mean!")
+            else:
+                series.append(mean)
 
-        df["receive_time"] = (df["receive_time"] // (250 * 1e6)) # ns -> s (250ms segments)
-        packet_counts = df.groupby('receive_time').size().reset_index(name="packet_count")
-        packet_size_bits = 1024 * 8
-        packet_counts["bitrate_ma"] = (packet_counts["packet_count"] * packet_size_bits) / (250 * 1e3)  # Mbps (based on 250ms segments)
-        packet_counts["receive_time"] = packet_counts["receive_time"] * 0.25 + offset
+    return series
 
-        packet_counts = packet_counts.dropna(subset=["bitrate_ma"])
-        packet_counts = packet_counts[packet_counts["receive_time"] > 50]
-        packet_counts = packet_counts[packet_counts["receive_time"] < 70]
-        mean = packet_counts["bitrate_ma"].mean()
+def bitrate_mean(df, offset):
+    df = df[df["receive_time"] != 0]
+    df = df.sort_values(by="receive_time")
 
-        if math.isnan(mean):
-            print(f"Warning: File {mean} contains NaN bitrate mean!")
-        else:
-            series.append(packet_counts["bitrate_ma"].mean())
+    df["receive_time"] = (df["receive_time"] // (250 * 1e6)) # ns -> s (250ms segments)
+    packet_counts = df.groupby('receive_time').size().reset_index(name="packet_count")
+    packet_size_bits = 1024 * 8
+    packet_counts["bitrate_ma"] = (packet_counts["packet_count"] * packet_size_bits) / (250 * 1e3)  # Mbps (based on 250ms segments)
+    packet_counts["receive_time"] = packet_counts["receive_time"] * 0.25 + offset
 
-    return series
+    packet_counts = packet_counts.dropna(subset=["bitrate_ma"])
+    packet_counts = packet_counts[packet_counts["receive_time"] > 50]
+    packet_counts = packet_counts[packet_counts["receive_time"] < 70]
+    return packet_counts["bitrate_ma"].mean()
 
 def main():
     simulation = load_sinle_series(base_simulation)
@@ -6,9 +6,7 @@ IFS=$'\n\t'
 
 mkdir -p ./results
 
-for run in $(seq 1 100)
-do
-    echo "Starting simulation run $run ..."
-    bash -c '../../simulation/ns3 run simulate -- --seed="$1"' _ "$run"
-    mv ../../simulation/speedtest_0.csv ./results/${run}.csv
-done
+# All 100 seeds in one invocation, one run per core. The runs are merged
+# into results/speedtest.csv (first column is the seed), see results/index.csv.
+echo "Starting simulation runs 1 to 100 ..."
+bash -c '../../simulation/ns3 run simulate -- --seeds=1-100 --output="$1"' _ "$(pwd)/results"
@@ -0,0 +1,190 @@
+#include "ns3/core-module.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/topology-loader-helper.h"
+#include "ns3/ipv4-flat-routing-helper.h"
+#include "ns3/link-schedule-driver.h"
+#include "ns3/trace-matrix-helper.h"
+#include "ns3/trace-context.h"
+#include "ns3/resource-usage.h"
+
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("Batch");
+
+// One line of the batch file:
+//   <name> topology=<file> [runtime=<s>] [seed=<n>] [routing=Global|Flat]
+//          [format=Csv|Binary] [schedule=<file>] [interval=<ms>]
+struct BatchScenario {
+    std::string name;
+    std::string topology;
+    std::string schedule;
+    std::string routing = "Global";
+    std::string format = "Csv";
+    double runtime = 30;
+    uint32_t seed = 1;
+    uint32_t interval = 40;
+};
+
+static std::vector<BatchScenario> LoadBatch(const std::string& filename) {
+    std::ifstream file(filename);
+    NS_ABORT_MSG_IF(!file.is_open(), "Unable to open batch file " << filename);
+
+    std::vector<BatchScenario> scenarios;
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        BatchScenario scenario;
+        if (!(tokens >> scenario.name)) {
+            continue;
+        }
+        std::string token;
+        while (tokens >> token) {
+            size_t eq = token.find('=');
+            NS_ABORT_MSG_IF(eq == std::string::npos, filename << ":" << lineNumber << ": expected key=value, got " << token);
+            std::string key = token.substr(0, eq);
+            std::string value = token.substr(eq + 1);
+            if (key == "topology") {
+                scenario.topology = value;
+            } else if (key == "schedule") {
+                scenario.schedule = value;
+            } else if (key == "routing") {
+                scenario.routing = value;
+            } else if (key == "format") {
+                scenario.format = value;
+            } else if (key == "runtime") {
+                scenario.runtime = std::stod(value);
+            } else if (key == "seed") {
+                scenario.seed = std::stoul(value);
+            } else if (key == "interval") {
+                scenario.interval = std::stoul(value);
+            } else {
+                NS_ABORT_MSG(filename << ":" << lineNumber << ": unknown key " << key);
+            }
+        }
+        NS_ABORT_MSG_IF(scenario.topology.empty(), filename << ":" << lineNumber << ": scenario without topology");
+        NS_ABORT_MSG_IF(scenario.routing != "Global" && scenario.routing != "Flat",
+                        filename << ":" << lineNumber << ": unknown routing " << scenario.routing);
+        scenarios.push_back(scenario);
+    }
+    return scenarios;
+}
+
+// Builds, runs and writes one scenario, leaves the simulator destroyed.
+static void RunScenario(const BatchScenario& scenario, const std::string& output, std::ostream& index) {
+    // Fresh process-wide state, so the scenario behaves as if run alone.
+    SeedManager::SetSeed(scenario.seed);
+    RngSeedManager::ResetNextStreamIndex();
+    Ipv4AddressGenerator::Reset();
+
+    auto buildStart = std::chrono::steady_clock::now();
+    TopologyLoaderHelper topology;
+    Ipv4FlatRoutingHelper flatRouting;
+    if (scenario.routing == "Flat") {
+        Ipv4ListRoutingHelper listRouting;
+        listRouting.Add(Ipv4StaticRoutingHelper(), 0);
+        listRouting.Add(flatRouting, -10);
+        topology.SetRoutingHelper(listRouting);
+    }
+    topology.Load(scenario.topology);
+    topology.InstallFlows();
+
+    // Kept until the end of the scenario, its events point to it.
+    Ptr<LinkScheduleDriver> linkSchedule;
+    if (!scenario.schedule.empty()) {
+        linkSchedule = CreateObject<LinkScheduleDriver>();
+        linkSchedule->AddLinks(topology.GetDevices());
+        linkSchedule->Load(scenario.schedule);
+        if (scenario.routing == "Flat") {
+            linkSchedule->SetRoutingTable(flatRouting.GetTable());
+        } else {
+            linkSchedule->SetAttribute("RecomputeGlobalRouting", BooleanValue(true));
+        }
+        linkSchedule->Start();
+    }
+
+    if (scenario.routing == "Flat") {
+        flatRouting.PopulateRoutingTables();
+    } else {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
+
+    TraceMatrixHelper traceMatrix;
+    traceMatrix.SetProbeInterval(scenario.interval);
+    traceMatrix.SetSenderAttribute("SummaryInterval", UintegerValue(5));
+    traceMatrix.SetSenderAttribute("OutputFormat", StringValue(scenario.format));
+    traceMatrix.AddAllPairs(topology.GetHosts());
+    traceMatrix.Install();
+    ApplicationContainer senders = traceMatrix.GetSenders();
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    Simulator::Stop(Seconds(scenario.runtime));
+    auto runStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    uint64_t events = Simulator::GetEventCount();
+
+    // Topology and schedule paths are relative to the start directory, only
+    // the results are written into the scenario directory.
+    std::string directory = output + "/" + scenario.name;
+    mkdir(directory.c_str(), 0755);
+    char cwd[PATH_MAX];
+    NS_ABORT_MSG_IF(!getcwd(cwd, sizeof(cwd)), "Unable to get the working directory");
+    NS_ABORT_MSG_IF(chdir(directory.c_str()) != 0, "Unable to enter " << directory);
+    auto writeStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < senders.GetN(); i++) {
+        DynamicCast<TraceSender>(senders.Get(i))->WriteResults();
+    }
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+    NS_ABORT_MSG_IF(chdir(cwd) != 0, "Unable to return to " << cwd);
+
+    index << scenario.name << ',' << topology.GetNodes().GetN() << ',' << traceMatrix.GetNPairs() << ','
+          << buildSeconds << ',' << runSeconds << ',' << writeSeconds << ',' << events << ','
+          << ResourceUsage::GetCurrentRssKiB() << std::endl;
+    NS_LOG_UNCOND(scenario.name << ": " << events << " events in " << runSeconds << "s");
+
+    if (linkSchedule) {
+        linkSchedule->Dispose();
+    }
+    // Also resets the trace registries, see TraceContext.
+    Simulator::Destroy();
+}
+
+int main(int argc, char* argv[]) {
+    std::string batchFile;
+    std::string output = "batch";
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Runs the scenarios of a batch file back to back in one process.");
+    cmd.AddValue("batch", "Batch file, one '<name> topology=<file> [key=value ...]' scenario per line", batchFile);
+    cmd.AddValue("output", "Result directory, one subdirectory per scenario and index.csv", output);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(batchFile.empty(), "Missing --batch");
+
+    std::vector<BatchScenario> scenarios = LoadBatch(batchFile);
+    mkdir(output.c_str(), 0755);
+    std::ofstream index(output + "/index.csv");
+    NS_ABORT_MSG_IF(!index.is_open(), "Unable to write " << output << "/index.csv");
+    index << "scenario,nodes,pairs,build_s,run_s,write_s,events,rss_kib" << std::endl;
+
+    for (const BatchScenario& scenario : scenarios) {
+        RunScenario(scenario, output, index);
+    }
+    NS_LOG_UNCOND("Ran " << scenarios.size() << " scenarios, " << TraceContext::GetGeneration()
+                  << " trace context resets");
+    return 0;
+}
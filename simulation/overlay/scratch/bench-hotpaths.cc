@@ -0,0 +1,375 @@
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/busytime-tracker.h"
+#include "ns3/packet-classifier.h"
+#include "ns3/trace-sender-application.h"
+#include "ns3/tcp-speedtest-sender.h"
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("BenchHotpaths");
+
+// Every allocation of the process is counted, including the ns-3 libraries.
+static uint64_t g_allocations = 0;
+
+void* operator new(std::size_t size) {
+    g_allocations++;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// One result row per benchmark variant: name,variant,ops,ns_per_op,allocs_per_op
+class BenchReport {
+public:
+    explicit BenchReport(std::ostream& out) : m_out(out) {
+        m_out << "benchmark,variant,ops,ns_per_op,allocs_per_op" << std::endl;
+    }
+
+    void Begin() {
+        m_allocations = g_allocations;
+        m_start = std::chrono::steady_clock::now();
+    }
+
+    void End(const std::string& benchmark, const std::string& variant, uint64_t ops) {
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - m_start).count();
+        uint64_t allocations = g_allocations - m_allocations;
+        char row[256];
+        snprintf(row, sizeof(row), "%s,%s,%" PRIu64 ",%.2f,%.3f", benchmark.c_str(), variant.c_str(), ops,
+                 ops ? ns / ops : 0, ops ? static_cast<double>(allocations) / ops : 0);
+        m_out << row << std::endl;
+    }
+
+private:
+    std::ostream& m_out;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t m_allocations;
+};
+
+static volatile uint64_t g_sink = 0;
+
+// Packets with a fixed share of trace probes and speed test packets. Probe
+// ids come from the sender, so they resolve to records like real probes.
+static std::vector<Ptr<Packet>> MakePackets(uint32_t count, double probeShare, double speedtestShare,
+                                            Ptr<TraceSender> sender) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<Ptr<Packet>> packets;
+    packets.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        Ptr<Packet> packet = Create<Packet>(1400);
+        double draw = uniform(rng);
+        if (draw < probeShare) {
+            packet->AddByteTag(TracePacketTag(sender->AppendRecord(0)));
+        } else if (draw < probeShare + speedtestShare) {
+            packet->AddByteTag(SpeedtestTag(i + 1));
+        }
+        packets.push_back(packet);
+    }
+    return packets;
+}
+
+static void BenchClassify(BenchReport& report, uint32_t count, uint32_t hops, double probeShare,
+                          double speedtestShare, Ptr<TraceSender> sender) {
+    std::vector<Ptr<Packet>> packets = MakePackets(count, probeShare, speedtestShare, sender);
+    PacketClassifier& classifier = PacketClassifier::GetInstance();
+
+    // Every packet is classified once per hop, as on its way through the devices.
+    for (bool cached : {true, false}) {
+        classifier.SetCacheEnabled(cached);
+        report.Begin();
+        uint64_t flags = 0;
+        for (const Ptr<Packet>& packet : packets) {
+            for (uint32_t hop = 0; hop < hops; hop++) {
+                flags += classifier.Classify(packet);
+            }
+        }
+        report.End("classify", cached ? "cached" : "uncached", static_cast<uint64_t>(count) * hops);
+        g_sink += flags;
+    }
+    classifier.SetCacheEnabled(true);
+}
+
+// Alternating start and stop of transmissions at a fixed rate, with a
+// query every queryEvery operations. Without a tracker only the event
+// overhead is measured.
+struct BusyTimeDriver {
+    Ptr<BusyTimeTracker> tracker;
+    uint64_t ops;
+    uint64_t done;
+    Time gap;
+    uint32_t queryEvery;
+    uint64_t window;
+    double ratios;
+
+    void Step() {
+        if (tracker) {
+            if (done % 2 == 0) {
+                tracker->StartTransmission();
+            } else {
+                tracker->StopTransmission();
+            }
+            if (queryEvery && done % queryEvery == 0) {
+                ratios += tracker->getBusyRatio(window);
+            }
+        }
+        if (++done < ops) {
+            Simulator::Schedule(gap, &BusyTimeDriver::Step, this);
+        }
+    }
+};
+
+static void BenchBusyTime(BenchReport& report, uint64_t ops, double rate, uint32_t queryEvery, Time window) {
+    Ptr<Node> node = CreateObject<Node>();
+    for (const std::string variant : {"baseline", "exact", "bucketed"}) {
+        BusyTimeDriver driver{nullptr, ops, 0, Seconds(1.0 / rate), queryEvery,
+                              static_cast<uint64_t>(window.GetNanoSeconds()), 0};
+        if (variant != "baseline") {
+            driver.tracker = Create<BusyTimeTracker>();
+            driver.tracker->setNode(node);
+            driver.tracker->setWindows({driver.window});
+            driver.tracker->setMode(variant == "exact" ? BusyTimeTracker::EXACT : BusyTimeTracker::BUCKETED);
+        }
+
+        report.Begin();
+        Simulator::ScheduleNow(&BusyTimeDriver::Step, &driver);
+        Simulator::Run();
+        report.End("busytime", variant, ops);
+        g_sink += static_cast<uint64_t>(driver.ratios);
+    }
+}
+
+// Sends pre-built packets over one point-to-point link, one per event.
+struct DeviceDriver {
+    Ptr<NetDevice> device;
+    std::vector<Ptr<Packet>> packets;
+    size_t next;
+    Time gap;
+
+    void Step() {
+        device->Send(packets[next], device->GetBroadcast(), 0x0800);
+        if (++next < packets.size()) {
+            Simulator::Schedule(gap, &DeviceDriver::Step, this);
+        }
+    }
+};
+
+static void BenchDevice(BenchReport& report, uint32_t count, double probeShare, double speedtestShare,
+                        Ptr<TraceSender> sender) {
+    NodeContainer nodes;
+    nodes.Create(2);
+    PointToPointHelper p2pHelper;
+    p2pHelper.SetDeviceAttribute("DataRate", StringValue("100Gbps"));
+    p2pHelper.SetChannelAttribute("Delay", TimeValue(MicroSeconds(1)));
+    NetDeviceContainer devices = p2pHelper.Install(nodes);
+
+    // Packets leave faster than they arrive, the queue stays empty.
+    for (const std::string variant : {"untagged", "mix"}) {
+        DeviceDriver driver{devices.Get(0), {}, 0, NanoSeconds(500)};
+        driver.packets = variant == "untagged" ? MakePackets(count, 0, 0, sender)
+                                               : MakePackets(count, probeShare, speedtestShare, sender);
+
+        report.Begin();
+        Simulator::ScheduleNow(&DeviceDriver::Step, &driver);
+        Simulator::Run();
+        report.End("device", variant, count);
+    }
+}
+
+// Self-rescheduling timers with the periods of the trace workloads: probe
+// intervals, transmit completions at 1Gbps and 100Mbps and on-off sends.
+// Every fourth tick also schedules a zero-delay event, like a probe that
+// completes on arrival.
+struct SchedulerDriver {
+    std::vector<Time> periods;
+    uint64_t ops;
+    uint64_t done;
+
+    void Tick(uint32_t timer) {
+        if (++done >= ops) {
+            return;
+        }
+        if (done % 4 == 0) {
+            Simulator::ScheduleNow(&SchedulerDriver::Follow, this);
+        }
+        Simulator::Schedule(periods[timer], &SchedulerDriver::Tick, this, timer);
+    }
+
+    void Follow() {
+        done++;
+    }
+};
+
+static void BenchScheduler(BenchReport& report, uint64_t ops, uint32_t timers) {
+    const Time kinds[] = {MilliSeconds(40), MicroSeconds(12), MicroSeconds(120), MilliSeconds(1)};
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int64_t> phase(0, MilliSeconds(40).GetTimeStep());
+
+    for (const std::string variant : {"Map", "Heap", "Calendar", "TimingWheel"}) {
+        ObjectFactory factory;
+        factory.SetTypeId("ns3::" + variant + "Scheduler");
+        Simulator::SetScheduler(factory);
+
+        SchedulerDriver driver{{}, ops, 0};
+        for (uint32_t i = 0; i < timers; i++) {
+            driver.periods.push_back(kinds[i % 4]);
+            Simulator::Schedule(TimeStep(phase(rng)), &SchedulerDriver::Tick, &driver, i);
+        }
+
+        report.Begin();
+        Simulator::Run();
+        report.End("scheduler", variant, driver.done);
+    }
+}
+
+static void BenchTraceWrite(BenchReport& report, uint32_t records, uint32_t hops) {
+    Ptr<TraceSender> sender = CreateObject<TraceSender>();
+    sender->SetNode(CreateObject<Node>());
+    sender->SetAttribute("FromNode", UintegerValue(900000));
+    sender->SetAttribute("ToNode", UintegerValue(900001));
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<uint32_t> delay(1000, 50000);
+    for (uint32_t i = 0; i < records; i++) {
+        uint64_t send = static_cast<uint64_t>(i) * 40000;
+        uint32_t seq = TraceFlowManager::ProbeIdToSeq(sender->AppendRecord(send));
+        // Every tenth probe is lost.
+        if (i % 10 == 9) {
+            continue;
+        }
+        for (uint32_t hop = 0; hop < hops; hop++) {
+            double capacity = 1e8 - hop * 1e6;
+            // The first hop is the sender node, as on a real path.
+            sender->AddDistributedHop(seq, capacity, &capacity, 1, 100 - hop, sender->GetNode()->GetId() + hop);
+        }
+        sender->CompleteDistributedRecord(seq, hops, send + delay(rng));
+    }
+
+    for (const std::string variant : {"Csv", "Binary"}) {
+        sender->SetAttribute("OutputFormat", StringValue(variant));
+        report.Begin();
+        sender->WriteResults();
+        report.End("trace-write", variant, records);
+        std::remove(variant == "Csv" ? "trace_900000_to_900001.csv" : "trace_900000_to_900001.trace");
+    }
+    sender->Dispose();
+}
+
+static void BenchSpeedtestWrite(BenchReport& report, uint32_t entries) {
+    Ptr<Node> node = CreateObject<Node>();
+    Ptr<TCPSpeedtestSender> sender = CreateObject<TCPSpeedtestSender>();
+    sender->SetNode(node);
+    for (uint32_t i = 0; i < entries; i++) {
+        uint64_t send = static_cast<uint64_t>(i) * 12000;
+        sender->AddEntry(send, send + 20000000, 20000000, 64000 + i % 1000, static_cast<int64_t>(i) * 1400);
+    }
+
+    report.Begin();
+    sender->WriteResults();
+    report.End("speedtest-write", "Csv", entries);
+    std::remove(("speedtest_" + std::to_string(node->GetId()) + ".csv").c_str());
+    sender->Dispose();
+}
+
+int main(int argc, char* argv[]) {
+    std::string only;
+    std::string output;
+    uint32_t packets = 200000;
+    uint32_t hops = 4;
+    double probeShare = 0.05;
+    double speedtestShare = 0.3;
+    uint64_t busyOps = 2000000;
+    double busyRate = 100000;
+    uint32_t queryEvery = 100;
+    std::string window = "100ms";
+    uint32_t records = 1000000;
+    uint64_t schedulerOps = 5000000;
+    uint32_t timers = 1000;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Measures the per packet cost of the instrumented point-to-point device and tracer paths.");
+    cmd.AddValue("only", "Run a single benchmark (classify, busytime, device, scheduler, trace-write, speedtest-write)", only);
+    cmd.AddValue("output", "CSV result file instead of stdout", output);
+    cmd.AddValue("packets", "Synthetic packets for classify and device", packets);
+    cmd.AddValue("hops", "Hops per packet for classify and per probe record for trace-write", hops);
+    cmd.AddValue("probeShare", "Share of packets tagged as trace probes", probeShare);
+    cmd.AddValue("speedtestShare", "Share of packets tagged as speed test packets", speedtestShare);
+    cmd.AddValue("busyOps", "Start and stop operations for busytime", busyOps);
+    cmd.AddValue("busyRate", "Operations per simulated second for busytime", busyRate);
+    cmd.AddValue("queryEvery", "Utilization query every this many busytime operations, 0 for none", queryEvery);
+    cmd.AddValue("window", "Utilization window for busytime queries", window);
+    cmd.AddValue("records", "Probe records for trace-write and entries for speedtest-write", records);
+    cmd.AddValue("schedulerOps", "Events for scheduler", schedulerOps);
+    cmd.AddValue("timers", "Concurrent periodic timers for scheduler", timers);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(probeShare + speedtestShare > 1, "Tag shares exceed 1");
+    NS_ABORT_MSG_IF(busyRate <= 0, "busyRate must be positive");
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        NS_ABORT_MSG_IF(!file.is_open(), "Unable to open " << output);
+    }
+    BenchReport report(output.empty() ? std::cout : file);
+
+    // Probe records of the packet benchmarks belong to this sender. Hops
+    // compare against its node, which is set directly: an installed
+    // application would start in the first Simulator::Run.
+    Ptr<TraceSender> probeSender = CreateObject<TraceSender>();
+    probeSender->SetNode(CreateObject<Node>());
+
+    if (only.empty() || only == "classify") {
+        BenchClassify(report, packets, hops, probeShare, speedtestShare, probeSender);
+    }
+    if (only.empty() || only == "busytime") {
+        BenchBusyTime(report, busyOps, busyRate, queryEvery, Time(window));
+    }
+    if (only.empty() || only == "device") {
+        BenchDevice(report, packets, probeShare, speedtestShare, probeSender);
+    }
+    if (only.empty() || only == "scheduler") {
+        BenchScheduler(report, schedulerOps, timers);
+    }
+    if (only.empty() || only == "trace-write") {
+        BenchTraceWrite(report, records, hops);
+    }
+    if (only.empty() || only == "speedtest-write") {
+        BenchSpeedtestWrite(report, records);
+    }
+
+    probeSender->Dispose();
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,345 @@
+#include "ns3/core-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/topology-loader-helper.h"
+#include "ns3/ipv4-flat-routing-helper.h"
+#include "ns3/trace-matrix-helper.h"
+#include "ns3/resource-usage.h"
+#include "ns3/fork-pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <dirent.h>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("ScaleBenchmark");
+
+struct ScenarioOptions {
+    std::string topology;
+    uint32_t size;
+    std::string linkRate;
+    double load;
+    uint32_t flowsPerHost;
+    uint32_t probePairs;
+    uint32_t degree;
+    uint32_t seed;
+};
+
+// Edge-list topology in the format of TopologyLoaderHelper.
+struct Scenario {
+    uint32_t nodes = 0;
+    std::vector<uint32_t> hosts;
+    std::vector<std::pair<uint32_t, uint32_t>> links;
+    std::vector<std::pair<uint32_t, uint32_t>> flows;
+};
+
+// N host pairs, left host i sends to right host i over one bottleneck.
+static Scenario MakeDumbbell(uint32_t pairs) {
+    Scenario scenario;
+    uint32_t left = 2 * pairs;
+    uint32_t right = left + 1;
+    scenario.nodes = right + 1;
+    for (uint32_t i = 0; i < pairs; i++) {
+        scenario.hosts.push_back(i);
+        scenario.hosts.push_back(pairs + i);
+        scenario.links.push_back({i, left});
+        scenario.links.push_back({pairs + i, right});
+        scenario.flows.push_back({i, pairs + i});
+    }
+    scenario.links.push_back({left, right});
+    return scenario;
+}
+
+// k-ary fat-tree: (k/2)^2 core switches, k pods of k/2 aggregation and k/2
+// edge switches, k/2 hosts per edge switch.
+static Scenario MakeFatTree(uint32_t k) {
+    NS_ABORT_MSG_IF(k < 2 || k % 2 != 0, "Fat-tree arity must be even, got " << k);
+    Scenario scenario;
+    uint32_t half = k / 2;
+    uint32_t core = 0;
+    uint32_t aggregation = core + half * half;
+    uint32_t edge = aggregation + k * half;
+    uint32_t host = edge + k * half;
+    scenario.nodes = host + k * half * half;
+
+    for (uint32_t pod = 0; pod < k; pod++) {
+        for (uint32_t a = 0; a < half; a++) {
+            for (uint32_t c = 0; c < half; c++) {
+                scenario.links.push_back({core + a * half + c, aggregation + pod * half + a});
+            }
+            for (uint32_t e = 0; e < half; e++) {
+                scenario.links.push_back({aggregation + pod * half + a, edge + pod * half + e});
+            }
+        }
+        for (uint32_t e = 0; e < half; e++) {
+            for (uint32_t h = 0; h < half; h++) {
+                uint32_t id = host + (pod * half + e) * half + h;
+                scenario.hosts.push_back(id);
+                scenario.links.push_back({edge + pod * half + e, id});
+            }
+        }
+    }
+    return scenario;
+}
+
+// Connected random graph of n nodes: a random spanning tree plus random
+// extra links up to the average degree. Every node is a host.
+static Scenario MakeRandomGraph(uint32_t n, uint32_t degree, std::mt19937& rng) {
+    NS_ABORT_MSG_IF(n < 2, "Random graphs need at least 2 nodes");
+    Scenario scenario;
+    scenario.nodes = n;
+    std::set<std::pair<uint32_t, uint32_t>> present;
+    auto addLink = [&](uint32_t a, uint32_t b) {
+        std::pair<uint32_t, uint32_t> key(std::min(a, b), std::max(a, b));
+        if (a != b && present.insert(key).second) {
+            scenario.links.push_back(key);
+        }
+    };
+
+    for (uint32_t i = 1; i < n; i++) {
+        addLink(i, std::uniform_int_distribution<uint32_t>(0, i - 1)(rng));
+    }
+    uint64_t target = std::min<uint64_t>(static_cast<uint64_t>(n) * degree / 2, static_cast<uint64_t>(n) * (n - 1) / 2);
+    std::uniform_int_distribution<uint32_t> any(0, n - 1);
+    while (scenario.links.size() < target) {
+        addLink(any(rng), any(rng));
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        scenario.hosts.push_back(i);
+    }
+    return scenario;
+}
+
+static Scenario MakeScenario(const ScenarioOptions& options, std::mt19937& rng) {
+    Scenario scenario;
+    if (options.topology == "dumbbell") {
+        scenario = MakeDumbbell(options.size);
+    } else if (options.topology == "fattree") {
+        scenario = MakeFatTree(options.size);
+    } else if (options.topology == "random") {
+        scenario = MakeRandomGraph(options.size, options.degree, rng);
+    } else {
+        NS_ABORT_MSG("Unknown topology " << options.topology);
+    }
+
+    // Dumbbell flows cross the bottleneck, elsewhere hosts send to random hosts.
+    if (options.topology != "dumbbell") {
+        std::uniform_int_distribution<size_t> anyHost(0, scenario.hosts.size() - 1);
+        for (uint32_t host : scenario.hosts) {
+            for (uint32_t f = 0; f < options.flowsPerHost; f++) {
+                uint32_t to = host;
+                while (to == host) {
+                    to = scenario.hosts[anyHost(rng)];
+                }
+                scenario.flows.push_back({host, to});
+            }
+        }
+    }
+    return scenario;
+}
+
+static void WriteScenario(const Scenario& scenario, const ScenarioOptions& options, double runtime,
+                          const std::string& filename) {
+    std::ofstream file(filename);
+    NS_ABORT_MSG_IF(!file.is_open(), "Unable to write " << filename);
+    file << "# " << options.topology << " of size " << options.size << ", load " << options.load << std::endl;
+    file << "nodes " << scenario.nodes << std::endl;
+    file << "hosts";
+    for (uint32_t host : scenario.hosts) {
+        file << ' ' << host;
+    }
+    file << std::endl;
+    for (const auto& link : scenario.links) {
+        file << link.first << ' ' << link.second << ' ' << options.linkRate << " 100us 100p" << std::endl;
+    }
+
+    // Each flow gets its share of the load of the sending host's link. All
+    // dumbbell flows share the one bottleneck, there load is its utilization.
+    double flowRate = DataRate(options.linkRate).GetBitRate() * options.load / std::max(1u, options.flowsPerHost);
+    if (options.topology == "dumbbell") {
+        flowRate = DataRate(options.linkRate).GetBitRate() * options.load / std::max<size_t>(1, scenario.flows.size());
+    }
+    for (const auto& flow : scenario.flows) {
+        file << "flow " << flow.first << ' ' << flow.second << ' ' << static_cast<uint64_t>(flowRate) << "bps 1s "
+             << runtime << "s" << std::endl;
+    }
+}
+
+static uint64_t TraceOutputBytes() {
+    uint64_t bytes = 0;
+    DIR* directory = opendir(".");
+    if (!directory) {
+        return 0;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+        struct stat info;
+        if (std::string(entry->d_name).rfind("trace_", 0) == 0 && stat(entry->d_name, &info) == 0) {
+            bytes += info.st_size;
+        }
+    }
+    closedir(directory);
+    return bytes;
+}
+
+// Builds and runs one configuration in the current process, returns its CSV row.
+static std::string RunScenario(const ScenarioOptions& options, double runtime, const std::string& routing) {
+    std::mt19937 rng(options.seed);
+    Scenario scenario = MakeScenario(options, rng);
+    WriteScenario(scenario, options, runtime, "scenario.topo");
+
+    auto buildStart = std::chrono::steady_clock::now();
+    TopologyLoaderHelper topology;
+    Ipv4FlatRoutingHelper flatRouting;
+    if (routing == "Flat") {
+        Ipv4ListRoutingHelper listRouting;
+        listRouting.Add(Ipv4StaticRoutingHelper(), 0);
+        listRouting.Add(flatRouting, -10);
+        topology.SetRoutingHelper(listRouting);
+    }
+    topology.Load("scenario.topo");
+    topology.InstallFlows();
+    if (routing == "Flat") {
+        flatRouting.PopulateRoutingTables();
+    } else {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
+
+    // Probe pairs are drawn from the hosts without repetition.
+    NodeContainer hosts = topology.GetHosts();
+    std::vector<std::pair<uint32_t, uint32_t>> candidates;
+    for (uint32_t i = 0; i < hosts.GetN(); i++) {
+        for (uint32_t j = 0; j < hosts.GetN(); j++) {
+            if (i != j) {
+                candidates.push_back({i, j});
+            }
+        }
+    }
+    std::shuffle(candidates.begin(), candidates.end(), rng);
+    candidates.resize(std::min<size_t>(candidates.size(), options.probePairs));
+
+    TraceMatrixHelper traceMatrix;
+    traceMatrix.SetProbeInterval(40);
+    traceMatrix.SetSenderAttribute("SummaryInterval", UintegerValue(5));
+    for (const auto& pair : candidates) {
+        traceMatrix.AddPair(hosts.Get(pair.first), hosts.Get(pair.second));
+    }
+    traceMatrix.Install();
+    ApplicationContainer senders = traceMatrix.GetSenders();
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    Simulator::Stop(Seconds(runtime));
+    auto runStart = std::chrono::steady_clock::now();
+    Simulator::Run();
+    double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    uint64_t events = Simulator::GetEventCount();
+
+    auto writeStart = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < senders.GetN(); i++) {
+        DynamicCast<TraceSender>(senders.Get(i))->WriteResults();
+    }
+    double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - writeStart).count();
+
+    std::ostringstream row;
+    row << options.topology << ',' << options.size << ',' << scenario.nodes << ',' << scenario.links.size() << ','
+        << scenario.hosts.size() << ',' << scenario.flows.size() << ',' << candidates.size() << ',' << runtime << ','
+        << buildSeconds << ',' << runSeconds << ',' << writeSeconds << ',' << events << ','
+        << (runSeconds > 0 ? events / runSeconds : 0) << ',' << ResourceUsage::GetPeakRssKiB() << ','
+        << TraceOutputBytes();
+
+    Simulator::Destroy();
+    return row.str();
+}
+
+int main(int argc, char* argv[]) {
+    ScenarioOptions options;
+    options.topology = "dumbbell";
+    options.linkRate = "100Mbps";
+    options.load = 0.5;
+    options.flowsPerHost = 1;
+    options.probePairs = 16;
+    options.degree = 3;
+    options.seed = 1;
+    std::string sizes = "2,4,8,16,32,64";
+    double runtime = 10;
+    std::string routing = "Flat";
+    std::string output = "scale.csv";
+    bool keep = false;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Sweeps generated topologies of growing size and reports the cost of trace generation.");
+    cmd.AddValue("topology", "Generated topology (dumbbell, fattree or random)", options.topology);
+    cmd.AddValue("sizes", "Comma separated sizes: host pairs, fat-tree arity or random graph nodes", sizes);
+    cmd.AddValue("runtime", "Simulated seconds per configuration", runtime);
+    cmd.AddValue("linkRate", "Data rate of every link", options.linkRate);
+    cmd.AddValue("load", "Cross traffic per host as a share of its link rate, of the bottleneck for dumbbell", options.load);
+    cmd.AddValue("flowsPerHost", "Cross traffic flows per host (fattree and random)", options.flowsPerHost);
+    cmd.AddValue("probePairs", "Traced host pairs per configuration", options.probePairs);
+    cmd.AddValue("degree", "Average node degree of random graphs", options.degree);
+    cmd.AddValue("routing", "Routing (Global or Flat)", routing);
+    cmd.AddValue("seed", "Seed of the generated topologies, flows and probe pairs", options.seed);
+    cmd.AddValue("output", "Result CSV, rows are appended to an existing file", output);
+    cmd.AddValue("keep", "Keep the topology and trace files of every configuration", keep);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(routing != "Global" && routing != "Flat", "Unknown routing " << routing);
+
+    std::vector<uint32_t> sizeList;
+    std::istringstream sizeStream(sizes);
+    std::string size;
+    while (std::getline(sizeStream, size, ',')) {
+        sizeList.push_back(static_cast<uint32_t>(std::stoul(size)));
+    }
+
+    bool header = access(output.c_str(), F_OK) != 0;
+    std::ofstream results(output, std::ios::app);
+    NS_ABORT_MSG_IF(!results.is_open(), "Unable to open " << output);
+    if (header) {
+        results << "topology,size,nodes,links,hosts,flows,probe_pairs,sim_seconds,build_s,run_s,write_s,events,"
+                   "events_per_s,peak_rss_kib,output_bytes,status" << std::endl;
+    }
+
+    // Every configuration runs in its own process: a fresh simulator and
+    // its own peak RSS. They run one after the other, so timings do not
+    // compete for cores.
+    std::vector<std::string> directories;
+    for (uint32_t n : sizeList) {
+        directories.push_back("scale_" + options.topology + "_" + std::to_string(n));
+    }
+
+    ForkPool pool;
+    pool.SetWorkers(1);
+    pool.SetDoneCallback(Callback<void, uint32_t>([&](uint32_t task) {
+        std::string row = pool.GetReport(task);
+        bool ok = pool.Succeeded(task) && !row.empty();
+        if (!ok) {
+            row = options.topology + "," + std::to_string(sizeList[task]) + ",,,,,,,,,,,,,";
+        }
+        results << row << ',' << (ok ? "ok" : "failed") << std::endl;
+        NS_LOG_UNCOND(row << ',' << (ok ? "ok" : "failed"));
+
+        if (!keep && ok) {
+            std::error_code error;
+            std::filesystem::remove_all(directories[task], error);
+            NS_ABORT_MSG_IF(error, "Unable to remove " << directories[task] << ": " << error.message());
+        }
+    }));
+
+    int64_t task = pool.Run(directories);
+    if (task >= 0) {
+        options.size = sizeList[task];
+        pool.Report(RunScenario(options, runtime, routing));
+        _exit(0);
+    }
+    return 0;
+}
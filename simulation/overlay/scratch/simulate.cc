@@ -5,12 +5,23 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/network-module.h"
 #include "ns3/applications-module.h"
+#include "ns3/topology-loader-helper.h"
+#include "ns3/ipv4-flat-routing-helper.h"
+#include "ns3/link-schedule-driver.h"
+#include "ns3/simulation-telemetry.h"
 #include "ns3/tcp-speedtest-sender-helper.h"
 #include "ns3/tcp-speedtest-receiver-helper.h"
+#include "ns3/fork-pool.h"
 #include "ns3/internet-apps-module.h"
 
+#include <chrono>
 #include <fstream>
 #include <cinttypes>
+#include <climits>
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -22,40 +33,10 @@ static void PingRTTTraceCallback(std::string context, uint16_t seqNo, Time rtt)
     pingResults.push_back(std::tuple<uint64_t, uint64_t>(Simulator::Now().GetSeconds(), rtt.GetMilliSeconds()));
 }
 
-int main(int argc, char* argv[]) {
-    std::string bottleneckRate = "30Mbps";
-    uint64_t bottleneckDelayMilliSeconds = 10;
-    uint16_t fromNode = 0;
-    uint16_t toNode = 2;
-    uint64_t runtimeSeconds = 120;
-    bool useTcp = false;
-    bool ping = false;
-    uint32_t seed = 123456789;
-
-    CommandLine cmd(__FILE__);
-    cmd.AddValue("bottleneckRate", "Data rate of the bottleneck link", bottleneckRate);
-    cmd.AddValue("bottleneckDelay", "Nanosecond delay of the bottleneck link", bottleneckDelayMilliSeconds);
-    cmd.AddValue("from", "Speed test from node ID", fromNode);
-    cmd.AddValue("to", "Speed test to node ID", toNode);
-    cmd.AddValue("runtime", "Speedtest generation runtime seconds", runtimeSeconds);
-    cmd.AddValue("tcp", "Use TCP instead of UDP for cross traffic", useTcp);
-    cmd.AddValue("seed", "RNG seed", seed);
-    cmd.AddValue("ping", "Perform ICMP pings", ping);
-    cmd.Parse(argc, argv);
-
-    std::string socketFactory = "ns3::UdpSocketFactory";
-    if (useTcp) {
-        NS_LOG_UNCOND("WARNING: Using TCP for crosstraffic!");
-        socketFactory = "ns3::TcpSocketFactory";
-    }
-
-    SeedManager::SetSeed(seed);
-
-    Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
-    Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
-    Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue(6291456));
-
-    NodeContainer nodes;
+// Four hosts behind two bridges with a shared bottleneck link and constant
+// rate cross traffic in both directions, used without --topology.
+static void BuildDumbbell(NodeContainer& nodes, const std::string& bottleneckRate,
+                          uint64_t bottleneckDelayMilliSeconds, const std::string& socketFactory) {
     nodes.Create(4);
 
     NodeContainer bridges;
@@ -102,8 +83,6 @@ int main(int argc, char* argv[]) {
     ipv4Helper.SetBase("10.0.10.0", "255.255.255.0");
     ipv4Helper.Assign(bridgeLink);
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
-
     // n0 -> n2
     OnOffHelper onoff(socketFactory, Address(InetSocketAddress(Ipv4Address("10.0.3.1"), 1000)));
     onoff.SetConstantRate(DataRate("10Mbps"));
@@ -142,17 +121,215 @@ int main(int argc, char* argv[]) {
 
     app = sink.Install(nodes.Get(1));
     app.Start(Seconds(0));
+}
+
+// Forks one child per seed of the range "<first>-<last>", at most workers at
+// a time. Each child returns true with seed set, working in its own
+// directory <output>/<seed>. The parent returns false once all children are
+// done, after merging their speedtest files into <output>/speedtest.csv with
+// a leading seed column and writing <output>/index.csv.
+static bool RunReplications(const std::string& seedRange, uint32_t workers, const std::string& output,
+                            uint16_t fromNode, uint32_t& seed, int& status) {
+    uint32_t first, last;
+    char dash;
+    std::istringstream range(seedRange);
+    if (!(range >> first)) {
+        NS_ABORT_MSG("Bad seed range " << seedRange);
+    }
+    last = first;
+    if (range >> dash && (dash != '-' || !(range >> last) || last < first)) {
+        NS_ABORT_MSG("Bad seed range " << seedRange);
+    }
+
+    ForkPool pool;
+    pool.SetWorkers(workers);
+    mkdir(output.c_str(), 0755);
+    NS_LOG_UNCOND("Running seeds " << first << " to " << last << " with " << pool.GetWorkers() << " workers into "
+                  << output);
+
+    std::vector<std::string> directories;
+    for (uint64_t s = first; s <= last; s++) {
+        directories.push_back(output + "/" + std::to_string(s));
+    }
+    int64_t task = pool.Run(directories);
+    if (task >= 0) {
+        seed = first + static_cast<uint32_t>(task);
+        return true;
+    }
+
+    // Merge in seed order, independent of completion order.
+    std::ofstream merged(output + "/speedtest.csv");
+    std::ofstream index(output + "/index.csv");
+    index << "seed,status,first_row,rows" << std::endl;
+    uint64_t row = 0;
+    bool header = false;
+    status = 0;
+    for (uint32_t i = 0; i < directories.size(); i++) {
+        uint32_t replication = first + i;
+        std::string filename = directories[i] + "/speedtest_" + std::to_string(fromNode) + ".csv";
+        std::ifstream results(filename);
+        if (!pool.Succeeded(i) || !results.is_open()) {
+            index << replication << ",failed," << row << ",0" << std::endl;
+            status = 1;
+            continue;
+        }
+
+        std::string line;
+        uint64_t rows = 0;
+        if (std::getline(results, line) && !header) {
+            merged << "seed," << line << '\n';
+            header = true;
+        }
+        while (std::getline(results, line)) {
+            merged << replication << ',' << line << '\n';
+            rows++;
+        }
+        index << replication << ",ok," << row << ',' << rows << std::endl;
+        row += rows;
+
+        results.close();
+        std::remove(filename.c_str());
+        rmdir(directories[i].c_str());
+    }
+
+    NS_LOG_UNCOND("Merged " << row << " rows of " << directories.size() << " seeds into " << output << "/speedtest.csv");
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    std::string bottleneckRate = "30Mbps";
+    uint64_t bottleneckDelayMilliSeconds = 10;
+    uint16_t fromNode = 0;
+    uint16_t toNode = 2;
+    uint64_t runtimeSeconds = 120;
+    bool useTcp = false;
+    bool ping = false;
+    uint32_t seed = 123456789;
+    std::string topologyFile;
+    std::string routing = "Global";
+    std::string linkScheduleFile;
+    std::string seedRange;
+    uint32_t workers = 0;
+    std::string output = "replications";
+    bool telemetry = false;
+    std::string telemetryFile;
+    std::string scheduler = "Map";
+    bool streamResults = false;
+    std::string tracking = "Tag";
+    bool trackAtDevice = false;
+    uint32_t streams = 1;
+    uint32_t binMilliSeconds = 100;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bottleneckRate", "Data rate of the bottleneck link", bottleneckRate);
+    cmd.AddValue("bottleneckDelay", "Nanosecond delay of the bottleneck link", bottleneckDelayMilliSeconds);
+    cmd.AddValue("from", "Speed test from node ID", fromNode);
+    cmd.AddValue("to", "Speed test to node ID", toNode);
+    cmd.AddValue("runtime", "Speedtest generation runtime seconds", runtimeSeconds);
+    cmd.AddValue("tcp", "Use TCP instead of UDP for cross traffic", useTcp);
+    cmd.AddValue("seed", "RNG seed", seed);
+    cmd.AddValue("topology", "Edge-list topology file instead of the built-in dumbbell", topologyFile);
+    cmd.AddValue("routing", "Routing for --topology (Global or Flat)", routing);
+    cmd.AddValue("linkSchedule", "Timeline of link rate, delay and up/down changes for --topology", linkScheduleFile);
+    cmd.AddValue("ping", "Perform ICMP pings", ping);
+    cmd.AddValue("seeds", "Run every seed of a range, e.g. 1-100, in parallel instead of --seed", seedRange);
+    cmd.AddValue("workers", "Parallel runs for --seeds, 0 for one per core", workers);
+    cmd.AddValue("output", "Result directory for --seeds", output);
+    cmd.AddValue("telemetry", "Report simulation speed and memory to stderr every wall clock second", telemetry);
+    cmd.AddValue("telemetryFile", "Also write the --telemetry samples to this CSV file", telemetryFile);
+    cmd.AddValue("tracking", "Map speed test packets to chunks by byte tags or TCP stream offsets (Tag or Sequence)", tracking);
+    cmd.AddValue("trackAtDevice", "Take speed test send and receive times at the devices of both ends instead of the sockets", trackAtDevice);
+    cmd.AddValue("stream", "Write speed test records of unread chunks after a timeout and flush every write", streamResults);
+    cmd.AddValue("streams", "Parallel speed test streams, more than one also writes binned goodput, delay and fairness", streams);
+    cmd.AddValue("bin", "Milliseconds per row of the --streams goodput, delay and fairness file", binMilliSeconds);
+    cmd.AddValue("scheduler", "Event scheduler (Map, Heap, List, Calendar or TimingWheel)", scheduler);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(routing != "Global" && routing != "Flat", "Unknown routing " << routing);
+    NS_ABORT_MSG_IF(routing == "Flat" && topologyFile.empty(), "Flat routing needs --topology");
+    NS_ABORT_MSG_IF(!linkScheduleFile.empty() && topologyFile.empty(), "Link schedules need --topology");
+    TypeId schedulerType;
+    NS_ABORT_MSG_IF(!TypeId::LookupByNameFailSafe("ns3::" + scheduler + "Scheduler", &schedulerType),
+                    "Unknown scheduler " << scheduler);
+
+    if (!seedRange.empty()) {
+        // Workers run in their own directories, input paths must not be relative.
+        for (std::string* path : {&topologyFile, &linkScheduleFile}) {
+            char resolved[PATH_MAX];
+            if (!path->empty() && realpath(path->c_str(), resolved)) {
+                *path = resolved;
+            }
+        }
+
+        int status;
+        if (!RunReplications(seedRange, workers, output, fromNode, seed, status)) {
+            return status;
+        }
+    }
+
+    std::string socketFactory = "ns3::UdpSocketFactory";
+    if (useTcp) {
+        NS_LOG_UNCOND("WARNING: Using TCP for crosstraffic!");
+        socketFactory = "ns3::TcpSocketFactory";
+    }
+
+    SeedManager::SetSeed(seed);
+
+    Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
+    Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
+    Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue(6291456));
+    GlobalValue::Bind("SchedulerType", TypeIdValue(schedulerType));
+
+    NodeContainer nodes;
+    Ipv4FlatRoutingHelper flatRouting;
+    Ptr<LinkScheduleDriver> linkSchedule;
+    if (topologyFile.empty()) {
+        BuildDumbbell(nodes, bottleneckRate, bottleneckDelayMilliSeconds, socketFactory);
+    } else {
+        TopologyLoaderHelper topology;
+        if (routing == "Flat") {
+            // Static routing stays in front for loopback and local networks.
+            Ipv4ListRoutingHelper listRouting;
+            listRouting.Add(Ipv4StaticRoutingHelper(), 0);
+            listRouting.Add(flatRouting, -10);
+            topology.SetRoutingHelper(listRouting);
+        }
+        topology.Load(topologyFile);
+        nodes = topology.GetHosts();
+        topology.InstallFlows();
+
+        if (!linkScheduleFile.empty()) {
+            linkSchedule = CreateObject<LinkScheduleDriver>();
+            linkSchedule->AddLinks(topology.GetDevices());
+            linkSchedule->Load(linkScheduleFile);
+            if (routing == "Flat") {
+                linkSchedule->SetRoutingTable(flatRouting.GetTable());
+            } else {
+                linkSchedule->SetAttribute("RecomputeGlobalRouting", BooleanValue(true));
+            }
+            linkSchedule->Start();
+        }
+    }
+
+    if (routing == "Flat") {
+        flatRouting.PopulateRoutingTables();
+    } else {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
     // Install Tracers
-    Ptr<Node> fromNodePtr = nodes.Get(fromNode);
-    Ptr<Node> toNodePtr = nodes.Get(toNode);
+    Ptr<Node> fromNodePtr = NodeList::GetNode(fromNode);
+    Ptr<Node> toNodePtr = NodeList::GetNode(toNode);
 
     TCPSpeedtestSenderHelper speedtestSender(InetSocketAddress(toNodePtr->GetObject<Ipv4>()->GetAddress(1,0).GetLocal(), 5201), toNode);
-    speedtestSender.SetAttribute("TrackAtDevice", BooleanValue(false));
+    speedtestSender.SetAttribute("TrackAtDevice", BooleanValue(trackAtDevice));
     speedtestSender.SetAttribute("Protocol", StringValue ("ns3::TcpSocketFactory"));
     speedtestSender.SetAttribute("PacketSize", UintegerValue(1024));
     speedtestSender.SetAttribute("DataRate", DataRateValue(DataRate("10Mbps")));
     speedtestSender.SetAttribute("NoLimit", BooleanValue(true));
+    speedtestSender.SetAttribute("StreamResults", BooleanValue(streamResults));
+    speedtestSender.SetAttribute("Tracking", StringValue(tracking));
+    speedtestSender.SetStreams(streams);
+    speedtestSender.SetGroupAttribute("BinWidth", TimeValue(MilliSeconds(binMilliSeconds)));
 
     TCPSpeedtestReceiverHelper speedtestReceivcer(InetSocketAddress(Ipv4Address::GetAny(), 5201));
     speedtestReceivcer.SetAttribute("Protocol", StringValue("ns3::TcpSocketFactory"));
@@ -171,11 +348,31 @@ int main(int argc, char* argv[]) {
         pingApp.Stop(Seconds(100000));
     }
 
+    Ptr<SimulationTelemetry> simulationTelemetry;
+    if (telemetry || !telemetryFile.empty()) {
+        simulationTelemetry = CreateObject<SimulationTelemetry>();
+        simulationTelemetry->SetAttribute("File", StringValue(telemetryFile));
+        simulationTelemetry->Start();
+    }
+
     Simulator::Stop(Seconds(runtimeSeconds));
+    auto wallStart = std::chrono::steady_clock::now();
     Simulator::Run();
+    if (simulationTelemetry) {
+        simulationTelemetry->Sample();
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    uint64_t events = Simulator::GetEventCount();
+    NS_LOG_UNCOND("Executed " << events << " events in " << wallSeconds << "s ("
+                  << (wallSeconds > 0 ? events / wallSeconds : 0) << " events/s)");
 
-    Ptr<TCPSpeedtestSender> sender = DynamicCast<TCPSpeedtestSender>(senderApp.Get(0));
-    sender->WriteResults();
+    for (uint32_t i = 0; i < senderApp.GetN(); i++) {
+        DynamicCast<TCPSpeedtestSender>(senderApp.Get(i))->WriteResults();
+    }
+    Ptr<SpeedtestGroup> group = DynamicCast<TCPSpeedtestSender>(senderApp.Get(0))->GetGroup();
+    if (group) {
+        group->WriteResults();
+    }
 
     if (ping) {
         std::ostringstream oss;
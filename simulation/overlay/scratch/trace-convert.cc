@@ -0,0 +1,80 @@
+#include "ns3/core-module.h"
+#include "ns3/trace-file.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("TraceConverter");
+
+int main(int argc, char* argv[]) {
+    std::string input;
+    std::string output;
+    std::string routes;
+
+    CommandLine cmd(__FILE__);
+    cmd.Usage("Converts a binary trace file into the CSV trace format.");
+    cmd.AddValue("input", "Binary trace file", input);
+    cmd.AddValue("output", "CSV trace file (default: input with .csv extension)", output);
+    cmd.AddValue("routes", "Optional CSV file for the route dictionary", routes);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(input.empty(), "No input trace file given, use --input");
+    if (output.empty()) {
+        size_t dot = input.rfind('.');
+        output = (dot == std::string::npos ? input : input.substr(0, dot)) + ".csv";
+    }
+
+    TraceFileReader reader;
+    std::string error;
+    if (!reader.Open(input, error)) {
+        NS_LOG_UNCOND("Unable to read trace file: " << error);
+        return 1;
+    }
+
+    FILE* csv = fopen(output.c_str(), "w");
+    NS_ABORT_MSG_IF(!csv, "Unable to open " << output);
+
+    // Same header and number formatting as the CSV output of TraceSender.
+    const TraceFileHeader& header = reader.Header();
+    const TraceFileColumn* columns = reader.Columns();
+    for (uint16_t c = 0; c < header.column_count; c++) {
+        fprintf(csv, c == 0 ? "%s" : ",%s", columns[c].name);
+    }
+    fprintf(csv, "\n");
+
+    for (uint64_t r = 0; r < reader.Rows(); r++) {
+        const TraceCell* row = reader.Row(r);
+        for (uint16_t c = 0; c < header.column_count; c++) {
+            if (c != 0) {
+                fputc(',', csv);
+            }
+            if (columns[c].type == TRACE_COLUMN_F64) {
+                fprintf(csv, "%.2f", row[c].f);
+            } else {
+                fprintf(csv, "%" PRIu64, row[c].u);
+            }
+        }
+        fputc('\n', csv);
+    }
+    fclose(csv);
+
+    if (!routes.empty()) {
+        FILE* route_csv = fopen(routes.c_str(), "w");
+        NS_ABORT_MSG_IF(!route_csv, "Unable to open " << routes);
+        fprintf(route_csv, "route,nodes\n");
+        for (const TraceRoute& route : reader.Routes()) {
+            fprintf(route_csv, "%" PRIu32 ",", route.id);
+            for (size_t i = 0; i < route.nodes.size(); i++) {
+                fprintf(route_csv, i == 0 ? "%" PRIu32 : " %" PRIu32, route.nodes[i]);
+            }
+            fputc('\n', route_csv);
+        }
+        fclose(route_csv);
+    }
+
+    NS_LOG_UNCOND("Converted " << reader.Rows() << " rows of trace " << header.from_node << " -> "
+                  << header.to_node << " to " << output);
+    return 0;
+}
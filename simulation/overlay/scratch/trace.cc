@@ -5,45 +5,32 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/network-module.h"
 #include "ns3/applications-module.h"
+#include "ns3/topology-loader-helper.h"
+#include "ns3/ipv4-flat-routing-helper.h"
+#include "ns3/link-schedule-driver.h"
+#include "ns3/packet-classifier.h"
+#include "ns3/simulation-telemetry.h"
 #include "ns3/trace-sender-helper.h"
 #include "ns3/trace-receiver-helper.h"
+#include "ns3/trace-matrix-helper.h"
+#include "ns3/scenario-branch-helper.h"
 
-using namespace ns3;
-
-NS_LOG_COMPONENT_DEFINE("TraceGenerator");
-
-int main(int argc, char* argv[]) {
-    std::string bottleneckRate = "30Mbps";
-    uint64_t bottleneckDelayMilliSeconds = 10;
-    uint16_t fromNode = 0;
-    uint16_t toNode = 2;
-    uint64_t runtimeSeconds = 120;
-    bool useTcp = false;
-    uint32_t seed = 123456789;
-
-    CommandLine cmd(__FILE__);
-    cmd.AddValue("bottleneckRate", "Data rate of the bottleneck link", bottleneckRate);
-    cmd.AddValue("bottleneckDelay", "Nanosecond delay of the bottleneck link", bottleneckDelayMilliSeconds);
-    cmd.AddValue("from", "Trace file from node ID", fromNode);
-    cmd.AddValue("to", "Trace file to node ID", toNode);
-    cmd.AddValue("runtime", "Trace generation runtime seconds", runtimeSeconds);
-    cmd.AddValue("tcp", "Use TCP instead of UDP for cross traffic", useTcp);
-    cmd.AddValue("seed", "RNG seed", seed);
-    cmd.Parse(argc, argv);
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
 
-    std::string socketFactory = "ns3::UdpSocketFactory";
-    if (useTcp) {
-        NS_LOG_UNCOND("WARNING: Using TCP for crosstraffic!");
-        socketFactory = "ns3::TcpSocketFactory";
-    }
+#include <algorithm>
+#include <chrono>
+#include <sstream>
 
-    SeedManager::SetSeed(seed);
+using namespace ns3;
 
-    Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
-    Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
-    Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue(6291456));
+NS_LOG_COMPONENT_DEFINE("TraceGenerator");
 
-    NodeContainer nodes;
+// Four hosts behind two bridges with a shared bottleneck link and constant
+// rate cross traffic in both directions, used without --topology.
+static void BuildDumbbell(NodeContainer& nodes, NetDeviceContainer& bottleneck, const std::string& bottleneckRate,
+                          uint64_t bottleneckDelayMilliSeconds, const std::string& socketFactory) {
     nodes.Create(4);
 
     NodeContainer bridges;
@@ -64,6 +51,7 @@ int main(int argc, char* argv[]) {
     NetDeviceContainer n2toBridge1 = defaultHelper.Install(NodeContainer(nodes.Get(2), bridges.Get(1)));
     NetDeviceContainer n3toBridge1 = defaultHelper.Install(NodeContainer(nodes.Get(3), bridges.Get(1)));
     NetDeviceContainer bridgeLink = bottleneckHelper.Install(bridges);
+    bottleneck = bridgeLink;
 
     InternetStackHelper stackHelper;
     stackHelper.Install(nodes);
@@ -90,8 +78,6 @@ int main(int argc, char* argv[]) {
     ipv4Helper.SetBase("10.0.10.0", "255.255.255.0");
     ipv4Helper.Assign(bridgeLink);
 
-    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
-
     // n0 -> n2
     OnOffHelper onoff(socketFactory, Address(InetSocketAddress(Ipv4Address("10.0.3.1"), 1000)));
     onoff.SetConstantRate(DataRate("10Mbps"));
@@ -130,62 +116,368 @@ int main(int argc, char* argv[]) {
 
     app = sink.Install(nodes.Get(1));
     app.Start(Seconds(0));
+}
+
+// Random variables draw from the seed they were created with, a new seed
+// alone would only reach variables created after the fork. Renumbering the
+// streams of the stacks and applications restarts them from the new seed,
+// variables created later use automatic streams, which never collide.
+static void ReseedBranch(uint32_t seed) {
+    SeedManager::SetSeed(seed);
+    NodeContainer nodes = NodeContainer::GetGlobal();
+    int64_t stream = 0;
+    stream += InternetStackHelper().AssignStreams(nodes, stream);
+    for (uint32_t i = 0; i < nodes.GetN(); i++) {
+        for (uint32_t j = 0; j < nodes.Get(i)->GetNApplications(); j++) {
+            Ptr<Application> app = nodes.Get(i)->GetApplication(j);
+            if (Ptr<OnOffApplication> onoff = DynamicCast<OnOffApplication>(app)) {
+                stream += onoff->AssignStreams(stream);
+            } else if (Ptr<TraceSender> sender = DynamicCast<TraceSender>(app)) {
+                stream += sender->AssignStreams(stream);
+            }
+        }
+    }
+}
+
+// Applies the settings of a scenario branch after the fork:
+//   seed=<seed>                        seed of all random variables
+//   bottleneckRate=<rate>              rate of the dumbbell bottleneck
+//   linkRate=<link>:<rate>             rate of a --topology link
+//   flow=<from>:<to>:<rate>:<start>:<stop>[:tcp]   extra constant rate cross traffic
+static void ApplyBranch(const ScenarioBranchHelper::Branch& branch, const NetDeviceContainer& bottleneck,
+                        const NetDeviceContainer& links) {
+    uint16_t port = 2000;
+    for (const auto& setting : branch.settings) {
+        const std::string& key = setting.first;
+        std::string value = setting.second;
+        std::replace(value.begin(), value.end(), ':', ' ');
+        std::istringstream iss(value);
+
+        if (key == "seed") {
+            uint32_t seed;
+            NS_ABORT_MSG_IF(!(iss >> seed), "Bad seed " << setting.second << " in branch " << branch.name);
+            ReseedBranch(seed);
+        } else if (key == "bottleneckRate") {
+            NS_ABORT_MSG_IF(bottleneck.GetN() == 0, "bottleneckRate needs the built-in dumbbell, use linkRate");
+            for (uint32_t i = 0; i < bottleneck.GetN(); i++) {
+                DynamicCast<PointToPointNetDevice>(bottleneck.Get(i))->SetDataRate(DataRate(setting.second));
+            }
+        } else if (key == "linkRate") {
+            uint32_t link;
+            std::string rate;
+            NS_ABORT_MSG_IF(!(iss >> link >> rate) || 2 * link + 1 >= links.GetN(),
+                            "Bad linkRate " << setting.second << " in branch " << branch.name);
+            DynamicCast<PointToPointNetDevice>(links.Get(2 * link))->SetDataRate(DataRate(rate));
+            DynamicCast<PointToPointNetDevice>(links.Get(2 * link + 1))->SetDataRate(DataRate(rate));
+        } else if (key == "flow") {
+            uint32_t from, to;
+            std::string rate, start, stop, protocol;
+            NS_ABORT_MSG_IF(!(iss >> from >> to >> rate >> start >> stop) || from >= NodeList::GetNNodes() ||
+                            to >= NodeList::GetNNodes(), "Bad flow " << setting.second << " in branch " << branch.name);
+            iss >> protocol;
+            std::string socketFactory = protocol == "tcp" ? "ns3::TcpSocketFactory" : "ns3::UdpSocketFactory";
+
+            // Start and stop are absolute, applications added now count from now.
+            Time now = Simulator::Now();
+            NS_ABORT_MSG_IF(Time(stop) <= now, "Flow " << setting.second << " of branch " << branch.name << " stops before the branch");
+            Time startTime = Max(Time(start) - now, Seconds(0));
+            Ptr<Node> toNode = NodeList::GetNode(to);
+            OnOffHelper onoff(socketFactory, Address(InetSocketAddress(toNode->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), port)));
+            onoff.SetConstantRate(DataRate(rate));
+            ApplicationContainer app = onoff.Install(NodeList::GetNode(from));
+            app.Start(startTime);
+            app.Stop(Time(stop) - now);
+
+            PacketSinkHelper sink(socketFactory, Address(InetSocketAddress(Ipv4Address::GetAny(), port)));
+            app = sink.Install(toNode);
+            app.Start(Seconds(0));
+            port++;
+        } else {
+            NS_ABORT_MSG("Unknown setting " << key << " in branch " << branch.name);
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string bottleneckRate = "30Mbps";
+    uint64_t bottleneckDelayMilliSeconds = 10;
+    uint16_t fromNode = 0;
+    uint16_t toNode = 2;
+    uint64_t runtimeSeconds = 120;
+    bool useTcp = false;
+    uint32_t seed = 123456789;
+    std::string topologyFile;
+    std::string routing = "Global";
+    std::string linkScheduleFile;
+    bool streamResults = false;
+    std::string utilizationTracking = "Exact";
+    std::string utilizationWindows = "100ms";
+    std::string probeMode = "Packet";
+    std::string outputFormat = "Csv";
+    std::string queueAccumulation = "Bottleneck";
+    bool allPairs = false;
+    bool useMpi = false;
+    std::string branchFile;
+    std::string branchTime = "20s";
+    uint32_t workers = 0;
+    std::string output = "branches";
+    bool telemetry = false;
+    std::string telemetryFile;
+    std::string scheduler = "Map";
+    bool classifierCache = true;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("bottleneckRate", "Data rate of the bottleneck link", bottleneckRate);
+    cmd.AddValue("bottleneckDelay", "Nanosecond delay of the bottleneck link", bottleneckDelayMilliSeconds);
+    cmd.AddValue("from", "Trace file from node ID", fromNode);
+    cmd.AddValue("to", "Trace file to node ID", toNode);
+    cmd.AddValue("runtime", "Trace generation runtime seconds", runtimeSeconds);
+    cmd.AddValue("tcp", "Use TCP instead of UDP for cross traffic", useTcp);
+    cmd.AddValue("seed", "RNG seed", seed);
+    cmd.AddValue("topology", "Edge-list topology file instead of the built-in dumbbell", topologyFile);
+    cmd.AddValue("routing", "Routing for --topology (Global or Flat)", routing);
+    cmd.AddValue("linkSchedule", "Timeline of link rate, delay and up/down changes for --topology", linkScheduleFile);
+    cmd.AddValue("stream", "Write trace rows while the simulation runs", streamResults);
+    cmd.AddValue("utilization", "Device busy time tracking (Exact or Bucketed)", utilizationTracking);
+    cmd.AddValue("windows", "Comma separated device utilization windows, one link_cap_<window> trace column each, e.g. 10ms,100ms,1s", utilizationWindows);
+    cmd.AddValue("probe", "Trace probe mode (Packet or Shadow)", probeMode);
+    cmd.AddValue("format", "Trace file format (Csv or Binary)", outputFormat);
+    cmd.AddValue("queue", "Queue accumulation that feeds queue_capacity (Sum, Bottleneck or SumToBottleneck)", queueAccumulation);
+    cmd.AddValue("allPairs", "Trace every pair of hosts in one run instead of --from/--to", allPairs);
+    cmd.AddValue("branches", "Scenario branches forked from one shared prefix, see ScenarioBranchHelper", branchFile);
+    cmd.AddValue("branchAt", "Simulation time at which --branches are forked", branchTime);
+    cmd.AddValue("workers", "Parallel branches, 0 for one per core", workers);
+    cmd.AddValue("output", "Result directory for --branches", output);
+    cmd.AddValue("telemetry", "Report simulation speed and memory to stderr every wall clock second", telemetry);
+    cmd.AddValue("telemetryFile", "Also write the --telemetry samples to this CSV file", telemetryFile);
+    cmd.AddValue("scheduler", "Event scheduler (Map, Heap, List, Calendar or TimingWheel)", scheduler);
+    cmd.AddValue("classifierCache", "Cache the tags of a packet per UID, disable to compare events/s without the cache", classifierCache);
+#ifdef NS3_MPI
+    cmd.AddValue("mpi", "Distribute the simulation over MPI ranks, see the rank lines of --topology", useMpi);
+#endif
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_IF(routing != "Global" && routing != "Flat", "Unknown routing " << routing);
+    NS_ABORT_MSG_IF(routing == "Flat" && topologyFile.empty(), "Flat routing needs --topology");
+    NS_ABORT_MSG_IF(!linkScheduleFile.empty() && topologyFile.empty(), "Link schedules need --topology");
+    TypeId schedulerType;
+    NS_ABORT_MSG_IF(!TypeId::LookupByNameFailSafe("ns3::" + scheduler + "Scheduler", &schedulerType),
+                    "Unknown scheduler " << scheduler);
+    // Streamed trace files are opened before the fork and would be shared.
+    NS_ABORT_MSG_IF(!branchFile.empty() && (streamResults || useMpi), "Branches can not be combined with --stream or --mpi");
+
+    std::string socketFactory = "ns3::UdpSocketFactory";
+    if (useTcp) {
+        NS_LOG_UNCOND("WARNING: Using TCP for crosstraffic!");
+        socketFactory = "ns3::TcpSocketFactory";
+    }
+
+    SeedManager::SetSeed(seed);
+
+    Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue("ns3::TcpCubic"));
+    Config::SetDefault ("ns3::TcpSocket::RcvBufSize", UintegerValue(6291456));
+    Config::SetDefault ("ns3::TcpSocket::SndBufSize", UintegerValue(6291456));
+    Config::SetDefault ("ns3::PointToPointNetDevice::UtilizationTracking", StringValue(utilizationTracking));
+    Config::SetDefault ("ns3::PointToPointNetDevice::UtilizationWindows", StringValue(utilizationWindows));
+    Config::SetDefault ("ns3::TraceSender::QueueAccumulation", StringValue(queueAccumulation));
+    GlobalValue::Bind("SchedulerType", TypeIdValue(schedulerType));
+    if (!classifierCache) {
+        PacketClassifier::GetInstance().SetCacheEnabled(false);
+    }
+
+#ifdef NS3_MPI
+    if (useMpi) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        TraceFlowManager::GetInstance().EnableDistributed(MpiInterface::GetSystemId(), MpiInterface::GetSize());
+        NS_LOG_UNCOND("Rank " << MpiInterface::GetSystemId() << " of " << MpiInterface::GetSize());
+    }
+#endif
+    // Applications are only installed on nodes of the local rank.
+    auto isLocal = [](Ptr<Node> node) { return node->GetSystemId() == Simulator::GetSystemId(); };
+
+    NodeContainer nodes;
+    NetDeviceContainer bottleneck;
+    NetDeviceContainer links;
+    Ipv4FlatRoutingHelper flatRouting;
+    Ptr<LinkScheduleDriver> linkSchedule;
+    if (topologyFile.empty()) {
+        BuildDumbbell(nodes, bottleneck, bottleneckRate, bottleneckDelayMilliSeconds, socketFactory);
+    } else {
+        TopologyLoaderHelper topology;
+        if (routing == "Flat") {
+            // Static routing stays in front for loopback and local networks.
+            Ipv4ListRoutingHelper listRouting;
+            listRouting.Add(Ipv4StaticRoutingHelper(), 0);
+            listRouting.Add(flatRouting, -10);
+            topology.SetRoutingHelper(listRouting);
+        }
+        topology.Load(topologyFile);
+        nodes = topology.GetHosts();
+        links = topology.GetDevices();
+        topology.InstallFlows();
+
+        if (!linkScheduleFile.empty()) {
+            linkSchedule = CreateObject<LinkScheduleDriver>();
+            linkSchedule->AddLinks(topology.GetDevices());
+            linkSchedule->Load(linkScheduleFile);
+            if (routing == "Flat") {
+                linkSchedule->SetRoutingTable(flatRouting.GetTable());
+            } else {
+                linkSchedule->SetAttribute("RecomputeGlobalRouting", BooleanValue(true));
+            }
+            linkSchedule->Start();
+        }
+    }
+
+    if (routing == "Flat") {
+        flatRouting.PopulateRoutingTables();
+    } else {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
 
     // Install Tracers
-    Ptr<Node> fromNodePtr = nodes.Get(fromNode);
-    Ptr<Node> toNodePtr = nodes.Get(toNode);
+    Ptr<Node> fromNodePtr = NodeList::GetNode(fromNode);
+    Ptr<Node> toNodePtr = NodeList::GetNode(toNode);
     int64_t trace_interval = 40; // each 40ms
     int64_t trace_summary = 5; // average 5 measurements = 200ms trace resolution
     
     ApplicationContainer traceSenderApps;
     ApplicationContainer traceReceiverApps;
+    ApplicationContainer traceSchedulerApps;
+
+    if (allPairs) {
+        // One sender per pair, one shared probe timer per source host.
+        TraceMatrixHelper traceMatrix;
+        traceMatrix.SetProbeInterval(trace_interval);
+        traceMatrix.SetSenderAttribute("SummaryInterval", UintegerValue(trace_summary));
+        traceMatrix.SetSenderAttribute("StreamResults", BooleanValue(streamResults));
+        traceMatrix.SetSenderAttribute("ProbeMode", StringValue(probeMode));
+        traceMatrix.SetSenderAttribute("OutputFormat", StringValue(outputFormat));
+        traceMatrix.AddAllPairs(nodes);
+        traceMatrix.Install();
+        traceSenderApps = traceMatrix.GetSenders();
+        traceReceiverApps = traceMatrix.GetReceivers();
+        traceSchedulerApps = traceMatrix.GetSchedulers();
+        traceSenderApps.Start(MilliSeconds(0));
+    } else {
+        Address toNodeAddress(InetSocketAddress(toNodePtr->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), 1020));
+        TraceSenderHelper fromTraceSender(toNodeAddress, fromNode, toNode);
+        fromTraceSender.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
+        fromTraceSender.SetAttribute("ProbeInterval", UintegerValue(trace_interval));
+        fromTraceSender.SetAttribute("SummaryInterval", UintegerValue(trace_summary));
+        fromTraceSender.SetAttribute("StreamResults", BooleanValue(streamResults));
+        fromTraceSender.SetAttribute("ProbeMode", StringValue(probeMode));
+        fromTraceSender.SetAttribute("OutputFormat", StringValue(outputFormat));
+        if (isLocal(fromNodePtr)) {
+            traceSenderApps.Add(fromTraceSender.Install(fromNodePtr));
+        }
+        TraceReceiverHelper toTraceReceiver(toNodeAddress);
+        toTraceReceiver.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
+        if (isLocal(toNodePtr)) {
+            traceReceiverApps.Add(toTraceReceiver.Install(toNodePtr));
+        }
 
-    Address toNodeAddress(InetSocketAddress(toNodePtr->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), 1020));
-    TraceSenderHelper fromTraceSender(toNodeAddress, fromNode, toNode);
-    fromTraceSender.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
-    fromTraceSender.SetAttribute("ProbeInterval", UintegerValue(trace_interval));
-    fromTraceSender.SetAttribute("SummaryInterval", UintegerValue(trace_summary));
-    traceSenderApps.Add(fromTraceSender.Install(fromNodePtr));
-    TraceReceiverHelper toTraceReceiver(toNodeAddress);
-    toTraceReceiver.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
-    traceReceiverApps.Add(toTraceReceiver.Install(toNodePtr));
-
-    Address fromNodeAddress(InetSocketAddress(fromNodePtr->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), 1021));
-    TraceSenderHelper toTraceSender(fromNodeAddress, toNode, fromNode);
-    toTraceSender.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
-    toTraceSender.SetAttribute("ProbeInterval", UintegerValue(trace_interval));
-    toTraceSender.SetAttribute("SummaryInterval", UintegerValue(trace_summary));
-    traceSenderApps.Add(toTraceSender.Install(toNodePtr));
-    TraceReceiverHelper fromTraceReceiver(fromNodeAddress);
-    fromTraceReceiver.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
-    traceReceiverApps.Add(fromTraceReceiver.Install(fromNodePtr));
+        Address fromNodeAddress(InetSocketAddress(fromNodePtr->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal(), 1021));
+        TraceSenderHelper toTraceSender(fromNodeAddress, toNode, fromNode);
+        toTraceSender.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
+        toTraceSender.SetAttribute("ProbeInterval", UintegerValue(trace_interval));
+        toTraceSender.SetAttribute("SummaryInterval", UintegerValue(trace_summary));
+        toTraceSender.SetAttribute("StreamResults", BooleanValue(streamResults));
+        toTraceSender.SetAttribute("ProbeMode", StringValue(probeMode));
+        toTraceSender.SetAttribute("OutputFormat", StringValue(outputFormat));
+        if (isLocal(toNodePtr)) {
+            traceSenderApps.Add(toTraceSender.Install(toNodePtr));
+        }
+        TraceReceiverHelper fromTraceReceiver(fromNodeAddress);
+        fromTraceReceiver.SetAttribute("Protocol", StringValue("ns3::UdpSocketFactory"));
+        if (isLocal(fromNodePtr)) {
+            traceReceiverApps.Add(fromTraceReceiver.Install(fromNodePtr));
+        }
+    }
     
     traceReceiverApps.Start(MilliSeconds(0));
 
     Ptr<UniformRandomVariable> startJitter = CreateObject<UniformRandomVariable>();
     startJitter->SetAttribute("Min", DoubleValue(0.0));
     startJitter->SetAttribute("Max", DoubleValue(trace_interval));
-    for (uint32_t i = 0; i < traceSenderApps.GetN(); i++) {
-        ApplicationContainer app;
-        app.Add(traceSenderApps.Get(i));
-        app.Start(MilliSeconds(startJitter->GetInteger()));
+    if (useMpi) {
+        // Ranks create different numbers of random variables before this one.
+        startJitter->SetStream(0);
+    }
+
+    ApplicationContainer jitteredApps = allPairs ? traceSchedulerApps : traceSenderApps;
+    if (!useMpi) {
+        for (uint32_t i = 0; i < jitteredApps.GetN(); i++) {
+            ApplicationContainer app;
+            app.Add(jitteredApps.Get(i));
+            app.Start(MilliSeconds(startJitter->GetInteger()));
+        }
+    } else {
+        // Ranks hold only their own applications. One draw per source node
+        // in a fixed order, so every rank count starts the same source at
+        // the same offset.
+        NodeContainer jitterSources = allPairs ? nodes : NodeContainer(fromNodePtr, toNodePtr);
+        for (uint32_t i = 0; i < jitterSources.GetN(); i++) {
+            Time start = MilliSeconds(startJitter->GetInteger());
+            for (uint32_t j = 0; j < jitteredApps.GetN(); j++) {
+                if (jitteredApps.Get(j)->GetNode() == jitterSources.Get(i)) {
+                    jitteredApps.Get(j)->SetStartTime(start);
+                }
+            }
+        }
     }
 
     Simulator::Stop(Seconds(runtimeSeconds));
+    auto wallStart = std::chrono::steady_clock::now();
+    if (!branchFile.empty()) {
+        ScenarioBranchHelper branches;
+        branches.SetWorkers(workers);
+        branches.SetOutput(output);
+        branches.Load(branchFile);
+        const ScenarioBranchHelper::Branch* branch = branches.Run(Time(branchTime));
+        if (!branch) {
+            Simulator::Destroy();
+            return branches.GetExitStatus();
+        }
+        ApplyBranch(*branch, bottleneck, links);
+    }
+
+    // Started after the fork, so branches do not share the telemetry file.
+    Ptr<SimulationTelemetry> simulationTelemetry;
+    if (telemetry || !telemetryFile.empty()) {
+        simulationTelemetry = CreateObject<SimulationTelemetry>();
+        simulationTelemetry->SetAttribute("File", StringValue(telemetryFile));
+        simulationTelemetry->Start();
+    }
     Simulator::Run();
+    if (simulationTelemetry) {
+        simulationTelemetry->Sample();
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    uint64_t events = Simulator::GetEventCount();
+    NS_LOG_UNCOND("Executed " << events << " events in " << wallSeconds << "s ("
+                  << (wallSeconds > 0 ? events / wallSeconds : 0) << " events/s)");
+
+    // Hands hop and reception details logged on other ranks to their senders.
+    TraceFlowManager::GetInstance().MergeDistributed();
 
     for (uint32_t i = 0; i < traceSenderApps.GetN(); i++) {
         Ptr<Application> app = traceSenderApps.Get(i);
         Ptr<TraceSender> traceSender = DynamicCast<TraceSender>(app);
 
         if (traceSender) {
-            traceSender->WriteResults(QueueAccumulationMethod::BOTTLENECK);
+            traceSender->WriteResults();
         } else {
             NS_LOG_ERROR ("Application is not of type TraceSender!");
         }
     }
 
     Simulator::Destroy();
+#ifdef NS3_MPI
+    if (useMpi) {
+        MpiInterface::Disable();
+    }
+#endif
 
     return 0;
 }
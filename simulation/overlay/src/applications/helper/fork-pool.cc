@@ -0,0 +1,129 @@
+#include "fork-pool.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ForkPool");
+
+ForkPool::ForkPool ()
+  : m_workers (0),
+    m_report (-1)
+{
+}
+
+uint32_t
+ForkPool::GetWorkers () const
+{
+  if (m_workers == 0)
+    {
+      return static_cast<uint32_t> (std::max (1L, sysconf (_SC_NPROCESSORS_ONLN)));
+    }
+  return m_workers;
+}
+
+int64_t
+ForkPool::Run (const std::vector<std::string> &directories)
+{
+  uint32_t workers = GetWorkers ();
+  m_succeeded.assign (directories.size (), false);
+  m_reports.assign (directories.size (), std::string ());
+
+  struct Child {
+    uint32_t task;
+    int report;   //!< Read end of the report pipe
+  };
+  std::map<pid_t, Child> running;
+  uint32_t next = 0;
+  while (next < directories.size () || !running.empty ())
+    {
+      if (next < directories.size () && running.size () < workers)
+        {
+          int channel[2];
+          NS_ABORT_MSG_IF (pipe (channel) != 0, "ForkPool: Unable to create a pipe");
+
+          // Nothing buffered may be written twice.
+          std::cout.flush ();
+          fflush (nullptr);
+
+          pid_t pid = fork ();
+          NS_ABORT_MSG_IF (pid < 0, "ForkPool: Unable to fork");
+          if (pid == 0)
+            {
+              close (channel[0]);
+              for (const auto &child : running)
+                {
+                  close (child.second.report);
+                }
+              m_report = channel[1];
+
+              const std::string &directory = directories[next];
+              mkdir (directory.c_str (), 0755);
+              NS_ABORT_MSG_IF (chdir (directory.c_str ()) != 0, "ForkPool: Unable to enter " << directory);
+              NS_LOG_INFO ("Task " << next << " in " << directory);
+              return next;
+            }
+          close (channel[1]);
+          running[pid] = {next++, channel[0]};
+          continue;
+        }
+
+      int status;
+      pid_t pid = waitpid (-1, &status, 0);
+      if (pid < 0)
+        {
+          break;
+        }
+      auto it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+
+      // The child is gone, so this reads its whole report up to EOF. A
+      // report fits the pipe buffer, the child never blocked on it.
+      uint32_t task = it->second.task;
+      char buffer[512];
+      ssize_t count;
+      while ((count = read (it->second.report, buffer, sizeof (buffer))) > 0)
+        {
+          m_reports[task].append (buffer, count);
+        }
+      close (it->second.report);
+      m_succeeded[task] = WIFEXITED (status) && WEXITSTATUS (status) == 0;
+      running.erase (it);
+
+      if (!m_done.IsNull ())
+        {
+          m_done (task);
+        }
+    }
+  return -1;
+}
+
+void
+ForkPool::Report (const std::string &report)
+{
+  NS_ABORT_MSG_IF (m_report < 0, "ForkPool: Only a child can report");
+  NS_ABORT_MSG_IF (report.size () > PIPE_BUF, "ForkPool: Report of " << report.size () << " bytes is too long");
+  NS_ABORT_MSG_IF (write (m_report, report.data (), report.size ()) != static_cast<ssize_t> (report.size ()),
+                   "ForkPool: Unable to report the result");
+}
+
+uint32_t
+ForkPool::GetNFailed () const
+{
+  return std::count (m_succeeded.begin (), m_succeeded.end (), false);
+}
+
+} // namespace ns3
@@ -0,0 +1,58 @@
+#ifndef FORK_POOL_H
+#define FORK_POOL_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "ns3/callback.h"
+
+namespace ns3 {
+
+/**
+ * Runs tasks in forked children of the simulator process, at most Workers
+ * at a time. Task i works in directory i, which is created if needed, so
+ * relative output files of the tasks never collide.
+ *
+ *   int64_t task = pool.Run (directories);
+ *   if (task >= 0) { ...run task...; pool.Report (row); return 0; }
+ *   ...parent, all children exited...
+ *
+ * A child may pass one short report (at most PIPE_BUF bytes, e.g. a CSV
+ * row) back to the parent with Report.
+ */
+class ForkPool
+{
+public:
+  ForkPool ();
+
+  // Parallel children, 0 for one per core.
+  void SetWorkers (uint32_t workers) { m_workers = workers; }
+  uint32_t GetWorkers () const;
+  // Called in the parent with the task of every child once it exited.
+  void SetDoneCallback (Callback<void, uint32_t> done) { m_done = done; }
+
+  /**
+   * Returns the task in a child, working in its directory. Returns -1 in
+   * the parent once all children exited.
+   */
+  int64_t Run (const std::vector<std::string> &directories);
+
+  // In a child: hands report to the parent, see GetReport.
+  void Report (const std::string &report);
+
+  // In the parent: whether the child of task exited with status 0.
+  bool Succeeded (uint32_t task) const { return m_succeeded[task]; }
+  const std::string &GetReport (uint32_t task) const { return m_reports[task]; }
+  uint32_t GetNFailed () const;
+
+private:
+  uint32_t m_workers;
+  Callback<void, uint32_t> m_done;
+  int m_report;   //!< Write end of the report pipe in a child, -1 otherwise
+  std::vector<bool> m_succeeded;
+  std::vector<std::string> m_reports;
+};
+
+} // namespace ns3
+
+#endif /* FORK_POOL_H */
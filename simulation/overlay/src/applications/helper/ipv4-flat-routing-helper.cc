@@ -0,0 +1,61 @@
+#include "ipv4-flat-routing-helper.h"
+
+#include "ns3/log.h"
+#include "ns3/ipv4-flat-routing.h"
+#include "ns3/resource-usage.h"
+#include "ns3/trace-sender-application.h"
+
+#include <chrono>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Ipv4FlatRoutingHelper");
+
+Ipv4FlatRoutingHelper::Ipv4FlatRoutingHelper ()
+  : m_table (Create<FlatRoutingTable> ())
+{
+}
+
+Ipv4FlatRoutingHelper *
+Ipv4FlatRoutingHelper::Copy (void) const
+{
+  return new Ipv4FlatRoutingHelper (*this);
+}
+
+Ptr<Ipv4RoutingProtocol>
+Ipv4FlatRoutingHelper::Create (Ptr<Node> node) const
+{
+  Ptr<Ipv4FlatRouting> routing = CreateObject<Ipv4FlatRouting> ();
+  routing->SetTable (m_table);
+  return routing;
+}
+
+void
+Ipv4FlatRoutingHelper::PopulateRoutingTables ()
+{
+  auto start = std::chrono::steady_clock::now ();
+  m_table->Build ();
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - start);
+  NS_LOG_INFO ("Flat routing for " << m_table->GetNNodes () << " nodes built in " << elapsed.count ()
+               << " ms, RSS " << ResourceUsage::GetCurrentRssKiB () << " KiB");
+}
+
+uint16_t
+Ipv4FlatRoutingHelper::GetRouteId (uint32_t from, uint32_t to) const
+{
+  std::vector<uint32_t> nodes = m_table->GetPath (from, to);
+  if (nodes.empty ())
+    {
+      return 0;
+    }
+
+  TracePathManager &paths = TracePathManager::GetInstance ();
+  uint16_t id = paths.GetOrCreateRouteId (std::vector<uint64_t> (nodes.begin (), nodes.end ()));
+  if (!paths.HasRoutePath (id))
+    {
+      paths.SetRoutePath (id, nodes);
+    }
+  return id;
+}
+
+} // namespace ns3
@@ -0,0 +1,52 @@
+#ifndef IPV4_FLAT_ROUTING_HELPER_H
+#define IPV4_FLAT_ROUTING_HELPER_H
+
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/node.h"
+#include "ns3/ptr.h"
+#include "ns3/flat-routing-table.h"
+
+namespace ns3 {
+
+/**
+ * Installs Ipv4FlatRouting on nodes, all sharing one FlatRoutingTable.
+ *
+ * Copies of the helper share the table too, so the helper can be added to
+ * an Ipv4ListRoutingHelper and still be populated afterwards:
+ *
+ *   Ipv4FlatRoutingHelper flat;
+ *   Ipv4ListRoutingHelper list;
+ *   list.Add (Ipv4StaticRoutingHelper (), 0);
+ *   list.Add (flat, -10);
+ *   ...install stacks, assign addresses...
+ *   flat.PopulateRoutingTables ();
+ *
+ * The table holds the adjacency of all nodes plus 4 bytes per node for every
+ * destination that is routed to, e.g. 40 KB per destination or at most
+ * 400 MB at 10k nodes.
+ */
+class Ipv4FlatRoutingHelper : public Ipv4RoutingHelper
+{
+public:
+  Ipv4FlatRoutingHelper ();
+
+  Ipv4FlatRoutingHelper *Copy (void) const override;
+  Ptr<Ipv4RoutingProtocol> Create (Ptr<Node> node) const override;
+
+  // Builds the shared table from the point-to-point links of all nodes,
+  // call once all addresses are assigned.
+  void PopulateRoutingTables ();
+
+  Ptr<FlatRoutingTable> GetTable () const { return m_table; }
+
+  // Trace route id of the current path between two nodes, the same id a
+  // probe along that path gets from TracePathManager. 0 if unreachable.
+  uint16_t GetRouteId (uint32_t from, uint32_t to) const;
+
+private:
+  Ptr<FlatRoutingTable> m_table;
+};
+
+} // namespace ns3
+
+#endif /* IPV4_FLAT_ROUTING_HELPER_H */
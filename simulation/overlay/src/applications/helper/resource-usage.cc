@@ -0,0 +1,44 @@
+#include "resource-usage.h"
+
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+uint64_t
+ResourceUsage::GetCurrentRssKiB ()
+{
+  FILE *statm = fopen ("/proc/self/statm", "r");
+  if (!statm)
+    {
+      return 0;
+    }
+
+  unsigned long size = 0;
+  unsigned long resident = 0;
+  int read = fscanf (statm, "%lu %lu", &size, &resident);
+  fclose (statm);
+  if (read != 2)
+    {
+      return 0;
+    }
+  return static_cast<uint64_t> (resident) * sysconf (_SC_PAGESIZE) / 1024;
+}
+
+uint64_t
+ResourceUsage::GetPeakRssKiB ()
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != 0)
+    {
+      return 0;
+    }
+#ifdef __APPLE__
+  return static_cast<uint64_t> (usage.ru_maxrss) / 1024;
+#else
+  return static_cast<uint64_t> (usage.ru_maxrss);
+#endif
+}
+
+} // namespace ns3
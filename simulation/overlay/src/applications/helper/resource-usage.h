@@ -0,0 +1,23 @@
+#ifndef RESOURCE_USAGE_H
+#define RESOURCE_USAGE_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Memory usage of the running simulation process, used to report the cost
+ * of building large scenarios. Both return 0 where not supported.
+ */
+class ResourceUsage
+{
+public:
+  // Current resident set size in KiB.
+  static uint64_t GetCurrentRssKiB ();
+  // Peak resident set size in KiB.
+  static uint64_t GetPeakRssKiB ();
+};
+
+} // namespace ns3
+
+#endif /* RESOURCE_USAGE_H */
@@ -0,0 +1,111 @@
+#include "scenario-branch-helper.h"
+#include "fork-pool.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ScenarioBranchHelper");
+
+ScenarioBranchHelper::ScenarioBranchHelper ()
+  : m_workers (0),
+    m_output ("branches"),
+    m_exitStatus (0)
+{
+}
+
+void
+ScenarioBranchHelper::AddBranch (const Branch &branch)
+{
+  NS_ABORT_MSG_IF (branch.name.empty () || branch.name.find ('/') != std::string::npos || branch.name[0] == '.',
+                   "ScenarioBranchHelper: Bad branch name " << branch.name);
+  for (const Branch &other : m_branches)
+    {
+      NS_ABORT_MSG_IF (other.name == branch.name, "ScenarioBranchHelper: Duplicate branch " << branch.name);
+    }
+  m_branches.push_back (branch);
+}
+
+void
+ScenarioBranchHelper::Load (const std::string &filename)
+{
+  std::ifstream file (filename);
+  NS_ABORT_MSG_IF (!file.is_open (), "ScenarioBranchHelper: Unable to open branch file " << filename);
+
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline (file, line))
+    {
+      lineNo++;
+      size_t comment = line.find ('#');
+      if (comment != std::string::npos)
+        {
+          line.erase (comment);
+        }
+
+      std::istringstream iss (line);
+      Branch branch;
+      if (!(iss >> branch.name))
+        {
+          continue;
+        }
+
+      std::string setting;
+      while (iss >> setting)
+        {
+          size_t separator = setting.find ('=');
+          NS_ABORT_MSG_IF (separator == std::string::npos || separator == 0,
+                           "ScenarioBranchHelper: Bad setting " << setting << " in line " << lineNo);
+          branch.settings.push_back ({setting.substr (0, separator), setting.substr (separator + 1)});
+        }
+      AddBranch (branch);
+    }
+}
+
+const ScenarioBranchHelper::Branch *
+ScenarioBranchHelper::Run (Time at)
+{
+  NS_ABORT_MSG_IF (m_branches.empty (), "ScenarioBranchHelper: No branches");
+  NS_ABORT_MSG_IF (at < Simulator::Now (), "ScenarioBranchHelper: Branch time " << at.As (Time::S) << " has passed");
+
+  Simulator::Stop (at - Simulator::Now ());
+  Simulator::Run ();
+  NS_ABORT_MSG_IF (Simulator::Now () != at, "ScenarioBranchHelper: Simulation stopped before the branch time");
+
+  ForkPool pool;
+  pool.SetWorkers (m_workers);
+  mkdir (m_output.c_str (), 0755);
+  NS_LOG_UNCOND ("Branching " << m_branches.size () << " scenarios at " << at.As (Time::S) << " with "
+                 << pool.GetWorkers () << " workers into " << m_output);
+
+  std::vector<std::string> directories;
+  for (const Branch &branch : m_branches)
+    {
+      directories.push_back (m_output + "/" + branch.name);
+    }
+  int64_t task = pool.Run (directories);
+  if (task >= 0)
+    {
+      return &m_branches[task];
+    }
+
+  std::ofstream index (m_output + "/index.csv");
+  index << "branch,status" << std::endl;
+  m_exitStatus = 0;
+  for (size_t i = 0; i < m_branches.size (); i++)
+    {
+      index << m_branches[i].name << ',' << (pool.Succeeded (i) ? "ok" : "failed") << std::endl;
+      m_exitStatus |= pool.Succeeded (i) ? 0 : 1;
+    }
+
+  NS_LOG_UNCOND ("Finished " << m_branches.size () << " branches, " << pool.GetNFailed () << " failed");
+  return 0;
+}
+
+} // namespace ns3
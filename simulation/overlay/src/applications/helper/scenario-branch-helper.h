@@ -0,0 +1,63 @@
+#ifndef SCENARIO_BRANCH_HELPER_H
+#define SCENARIO_BRANCH_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * Runs the shared prefix of several scenarios once and forks the simulator
+ * process into one child per branch, see ForkPool.
+ *
+ * Branch files have one branch per line, '#' starts a comment:
+ *
+ *   <name> [<key>=<value> ...]     e.g. fast bottleneckRate=50Mbps
+ *
+ * Keys may repeat, their meaning is up to the program applying them. Every
+ * child works in <output>/<name>, so relative output files of the branches
+ * never collide. The parent waits for all children and writes
+ * <output>/index.csv with the exit status of every branch.
+ */
+class ScenarioBranchHelper
+{
+public:
+  struct Branch {
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> settings;
+  };
+
+  ScenarioBranchHelper ();
+
+  void AddBranch (const Branch &branch);
+  void Load (const std::string &filename);
+  uint32_t GetNBranches () const { return m_branches.size (); }
+
+  // Parallel branches, 0 for one per core.
+  void SetWorkers (uint32_t workers) { m_workers = workers; }
+  void SetOutput (const std::string &directory) { m_output = directory; }
+
+  /**
+   * Runs the simulation until at, then forks. Returns the branch to apply
+   * in a child, which continues with Simulator::Run. Returns 0 in the
+   * parent once all children exited, the simulation must not be resumed
+   * there.
+   */
+  const Branch *Run (Time at);
+
+  // In the parent: 0 if every branch exited successfully, 1 otherwise.
+  int GetExitStatus () const { return m_exitStatus; }
+
+private:
+  std::vector<Branch> m_branches;
+  uint32_t m_workers;
+  std::string m_output;
+  int m_exitStatus;
+};
+
+} // namespace ns3
+
+#endif /* SCENARIO_BRANCH_HELPER_H */
@@ -7,12 +7,16 @@
 #include "ns3/boolean.h"
 #include "ns3/names.h"
 #include "ns3/data-rate.h"
+#include "ns3/abort.h"
+#include "ns3/tcp-speedtest-sender.h"
 
 namespace ns3 {
 
 TCPSpeedtestSenderHelper::TCPSpeedtestSenderHelper (Address address, uint32_t receiverId)
+  : m_streams (1)
 {
   m_factory.SetTypeId ("ns3::TCPSpeedtestSender");
+  m_groupFactory.SetTypeId ("ns3::SpeedtestGroup");
   m_factory.Set ("Remote", AddressValue (address));
   m_factory.Set ("ReceiverID", UintegerValue(receiverId));
 }
@@ -23,10 +27,38 @@ TCPSpeedtestSenderHelper::SetAttribute (std::string name, const AttributeValue &
   m_factory.Set (name, value);
 }
 
+void
+TCPSpeedtestSenderHelper::SetStreams (uint32_t streams)
+{
+  NS_ABORT_MSG_IF (streams == 0, "TCPSpeedtestSenderHelper: At least one stream is needed");
+  m_streams = streams;
+}
+
+void
+TCPSpeedtestSenderHelper::SetGroupAttribute (std::string name, const AttributeValue &value)
+{
+  m_groupFactory.Set (name, value);
+}
+
 ApplicationContainer
 TCPSpeedtestSenderHelper::Install (Ptr<Node> node) const
 {
-  return ApplicationContainer (InstallPriv (node));
+  if (m_streams == 1)
+    {
+      return ApplicationContainer (InstallPriv (node));
+    }
+
+  // All streams connect to the same receiver, which accepts one socket per
+  // stream.
+  ApplicationContainer apps;
+  Ptr<SpeedtestGroup> group = m_groupFactory.Create<SpeedtestGroup> ();
+  for (uint32_t i = 0; i < m_streams; i++)
+    {
+      Ptr<TCPSpeedtestSender> sender = DynamicCast<TCPSpeedtestSender> (InstallPriv (node));
+      sender->SetGroup (group);
+      apps.Add (sender);
+    }
+  return apps;
 }
 
 Ptr<Application>
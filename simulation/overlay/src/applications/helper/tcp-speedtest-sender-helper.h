@@ -19,11 +19,17 @@ class TCPSpeedtestSenderHelper
 public:
   TCPSpeedtestSenderHelper (Address address, uint32_t receiverId);
   void SetAttribute (std::string name, const AttributeValue &value);
+  // Installs streams parallel senders per node, which share one
+  // SpeedtestGroup if there is more than one.
+  void SetStreams (uint32_t streams);
+  void SetGroupAttribute (std::string name, const AttributeValue &value);
   ApplicationContainer Install (Ptr<Node> node) const;
 
 private:
   Ptr<Application> InstallPriv (Ptr<Node> node) const;
   ObjectFactory m_factory;
+  ObjectFactory m_groupFactory;
+  uint32_t m_streams;
 
 };
 
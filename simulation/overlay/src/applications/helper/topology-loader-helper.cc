@@ -0,0 +1,257 @@
+#include "topology-loader-helper.h"
+#include "resource-usage.h"
+
+#include "ns3/abort.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/queue-size.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TopologyLoaderHelper");
+
+TopologyLoaderHelper::TopologyLoaderHelper ()
+  : m_pool ("10.0.0.0"),
+    m_poolMask ("255.0.0.0"),
+    m_nodeCount (0)
+{
+}
+
+void
+TopologyLoaderHelper::SetAddressPool (Ipv4Address network, Ipv4Mask mask)
+{
+  m_pool = network.CombineMask (mask);
+  m_poolMask = mask;
+}
+
+void
+TopologyLoaderHelper::SetRoutingHelper (const Ipv4RoutingHelper &routing)
+{
+  m_stackHelper.SetRoutingHelper (routing);
+}
+
+void
+TopologyLoaderHelper::Load (const std::string &filename)
+{
+  auto start = std::chrono::steady_clock::now ();
+  uint64_t rssBefore = ResourceUsage::GetCurrentRssKiB ();
+
+  Parse (filename);
+  Build ();
+
+  double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+  uint64_t rssAfter = ResourceUsage::GetCurrentRssKiB ();
+  NS_LOG_UNCOND ("Loaded topology " << filename << ": " << m_nodes.GetN () << " nodes, "
+                 << m_links.size () << " links, " << m_flows.size () << " flows in " << seconds << "s (RSS "
+                 << rssAfter << " KiB, +" << (rssAfter > rssBefore ? rssAfter - rssBefore : 0) << " KiB)");
+}
+
+void
+TopologyLoaderHelper::Parse (const std::string &filename)
+{
+  std::ifstream file (filename);
+  NS_ABORT_MSG_IF (!file.is_open (), "TopologyLoaderHelper: Unable to open topology file " << filename);
+
+  uint32_t highestId = 0;
+  bool anyNode = false;
+  std::string line;
+  uint32_t lineNo = 0;
+  while (std::getline (file, line))
+    {
+      lineNo++;
+      size_t comment = line.find ('#');
+      if (comment != std::string::npos)
+        {
+          line.erase (comment);
+        }
+
+      std::istringstream iss (line);
+      std::string first;
+      if (!(iss >> first))
+        {
+          continue;
+        }
+
+      if (first == "nodes")
+        {
+          NS_ABORT_MSG_IF (!(iss >> m_nodeCount), "TopologyLoaderHelper: Bad node count in line " << lineNo);
+        }
+      else if (first == "hosts")
+        {
+          uint32_t host;
+          while (iss >> host)
+            {
+              m_hosts.push_back (host);
+              highestId = std::max (highestId, host);
+              anyNode = true;
+            }
+        }
+      else if (first == "rank")
+        {
+          uint32_t rank, node;
+          NS_ABORT_MSG_IF (!(iss >> rank), "TopologyLoaderHelper: Bad rank in line " << lineNo);
+          while (iss >> node)
+            {
+              m_rankLines.push_back ({node, rank});
+              highestId = std::max (highestId, node);
+              anyNode = true;
+            }
+        }
+      else if (first == "flow")
+        {
+          Flow flow;
+          std::string rate, start, stop, protocol;
+          NS_ABORT_MSG_IF (!(iss >> flow.from >> flow.to >> rate >> start >> stop),
+                           "TopologyLoaderHelper: Bad flow in line " << lineNo);
+          iss >> protocol;
+          flow.rate = DataRate (rate);
+          flow.start = Time (start);
+          flow.stop = Time (stop);
+          flow.tcp = protocol == "tcp";
+          m_flows.push_back (flow);
+          highestId = std::max ({highestId, flow.from, flow.to});
+          anyNode = true;
+        }
+      else
+        {
+          Link link;
+          std::string rate, delay, queue;
+          std::istringstream fields (line);
+          NS_ABORT_MSG_IF (!(fields >> link.from >> link.to >> rate >> delay >> queue),
+                           "TopologyLoaderHelper: Bad link in line " << lineNo);
+          NS_ABORT_MSG_IF (link.from == link.to, "TopologyLoaderHelper: Self loop in line " << lineNo);
+          link.rate = DataRate (rate);
+          link.delay = Time (delay);
+          link.queue = QueueSize (queue.back () == 'p' ? queue : queue + "p").GetValue ();
+          m_links.push_back (link);
+          highestId = std::max ({highestId, link.from, link.to});
+          anyNode = true;
+        }
+    }
+
+  if (m_nodeCount == 0 && anyNode)
+    {
+      m_nodeCount = highestId + 1;
+    }
+  NS_ABORT_MSG_IF (anyNode && highestId >= m_nodeCount,
+                   "TopologyLoaderHelper: Node id " << highestId << " exceeds node count " << m_nodeCount);
+}
+
+void
+TopologyLoaderHelper::Build ()
+{
+  m_ranks.assign (m_nodeCount, 0);
+  for (const std::pair<uint32_t, uint32_t> &line : m_rankLines)
+    {
+      m_ranks[line.first] = line.second;
+    }
+  for (uint32_t id = 0; id < m_nodeCount; id++)
+    {
+      m_nodes.Add (CreateObject<Node> (m_ranks[id]));
+    }
+
+  m_stackHelper.Install (m_nodes);
+
+  // Every link needs a /30 network of the pool.
+  uint64_t poolSize = static_cast<uint64_t> (~m_poolMask.Get ()) + 1;
+  NS_ABORT_MSG_IF (m_links.size () > poolSize / 4,
+                   "TopologyLoaderHelper: Address pool too small for " << m_links.size () << " links");
+
+  PointToPointHelper p2pHelper;
+  Ipv4AddressHelper ipv4Helper;
+  Ipv4Mask linkMask ("255.255.255.252");
+  uint32_t network = m_pool.Get ();
+  uint32_t poolEnd = static_cast<uint32_t> (m_pool.Get () + poolSize - 4);
+
+  m_devices = NetDeviceContainer ();
+  for (const Link &link : m_links)
+    {
+      p2pHelper.SetDeviceAttribute ("DataRate", DataRateValue (link.rate));
+      p2pHelper.SetChannelAttribute ("Delay", TimeValue (link.delay));
+      p2pHelper.SetQueue ("ns3::DropTailQueue<Packet>", "MaxSize",
+                          QueueSizeValue (QueueSize (QueueSizeUnit::PACKETS, link.queue)));
+      NetDeviceContainer devices = p2pHelper.Install (m_nodes.Get (link.from), m_nodes.Get (link.to));
+
+      // Skip networks handed out by other helpers before.
+      while (Ipv4AddressGenerator::IsNetworkAllocated (Ipv4Address (network), linkMask))
+        {
+          NS_ABORT_MSG_IF (network >= poolEnd, "TopologyLoaderHelper: Address pool exhausted");
+          network += 4;
+        }
+      ipv4Helper.SetBase (Ipv4Address (network), linkMask);
+      ipv4Helper.Assign (devices);
+      network += 4;
+
+      m_devices.Add (devices);
+    }
+}
+
+NodeContainer
+TopologyLoaderHelper::GetHosts () const
+{
+  if (m_hosts.empty ())
+    {
+      return m_nodes;
+    }
+
+  NodeContainer hosts;
+  for (uint32_t host : m_hosts)
+    {
+      hosts.Add (m_nodes.Get (host));
+    }
+  return hosts;
+}
+
+ApplicationContainer
+TopologyLoaderHelper::InstallFlows (uint16_t basePort) const
+{
+  NS_ABORT_MSG_IF (basePort + m_flows.size () > UINT16_MAX, "TopologyLoaderHelper: Too many flows for the port range");
+
+  ApplicationContainer apps;
+  for (size_t i = 0; i < m_flows.size (); i++)
+    {
+      const Flow &flow = m_flows[i];
+      std::string socketFactory = flow.tcp ? "ns3::TcpSocketFactory" : "ns3::UdpSocketFactory";
+      uint16_t port = static_cast<uint16_t> (basePort + i);
+
+      Ptr<Node> to = m_nodes.Get (flow.to);
+      NS_ABORT_MSG_IF (to->GetObject<Ipv4> ()->GetNInterfaces () < 2,
+                       "TopologyLoaderHelper: Flow destination " << flow.to << " has no link");
+
+      if (GetRank (flow.from) == Simulator::GetSystemId ())
+        {
+          OnOffHelper onoff (socketFactory, Address (InetSocketAddress (to->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal (), port)));
+          onoff.SetConstantRate (flow.rate);
+          ApplicationContainer app = onoff.Install (m_nodes.Get (flow.from));
+          app.Start (flow.start);
+          app.Stop (flow.stop);
+          apps.Add (app);
+        }
+
+      if (GetRank (flow.to) == Simulator::GetSystemId ())
+        {
+          PacketSinkHelper sink (socketFactory, Address (InetSocketAddress (Ipv4Address::GetAny (), port)));
+          ApplicationContainer app = sink.Install (to);
+          app.Start (Seconds (0));
+          apps.Add (app);
+        }
+    }
+  return apps;
+}
+
+} // namespace ns3
@@ -0,0 +1,100 @@
+#ifndef TOPOLOGY_LOADER_HELPER_H
+#define TOPOLOGY_LOADER_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ns3/data-rate.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * Builds a point-to-point topology from a compact edge-list file.
+ *
+ * One entry per line, '#' starts a comment:
+ *
+ *   nodes <count>                                  optional, else highest id + 1
+ *   hosts <id> [<id> ...]                          optional, end hosts for probing
+ *   rank <rank> <id> [<id> ...]                    optional, MPI rank of the nodes, else 0
+ *   <a> <b> <rate> <delay> <queue>                 link, e.g. 0 4 100Mbps 100ns 100p
+ *   flow <from> <to> <rate> <start> <stop> [tcp]   constant rate cross traffic
+ *
+ * All nodes get an internet stack. Every link gets its own /30 network out
+ * of the address pool, networks that are already allocated are skipped, so
+ * the first address of a node belongs to its first link.
+ *
+ * In distributed runs every rank loads the same file and builds the whole
+ * topology, links between ranks become remote channels. InstallFlows only
+ * installs applications on nodes of the local rank.
+ */
+class TopologyLoaderHelper
+{
+public:
+  struct Link {
+    uint32_t from;
+    uint32_t to;
+    DataRate rate;
+    Time delay;
+    uint32_t queue;   //!< Queue size in packets
+  };
+
+  struct Flow {
+    uint32_t from;
+    uint32_t to;
+    DataRate rate;
+    Time start;
+    Time stop;
+    bool tcp;
+  };
+
+  TopologyLoaderHelper ();
+
+  // Address pool the /30 link networks are taken from, 10.0.0.0/8 by default.
+  void SetAddressPool (Ipv4Address network, Ipv4Mask mask);
+  // Routing installed with the internet stack, the stack default if unset.
+  void SetRoutingHelper (const Ipv4RoutingHelper &routing);
+
+  // Parses the file and builds nodes, devices and addresses.
+  void Load (const std::string &filename);
+
+  NodeContainer GetNodes () const { return m_nodes; }
+  // Nodes listed in hosts lines, all nodes if there are none.
+  NodeContainer GetHosts () const;
+  const std::vector<Link> &GetLinks () const { return m_links; }
+  const std::vector<Flow> &GetFlows () const { return m_flows; }
+  // Devices of link i are at index 2 * i (from side) and 2 * i + 1 (to side).
+  NetDeviceContainer GetDevices () const { return m_devices; }
+
+  uint32_t GetRank (uint32_t node) const { return m_ranks.empty () ? 0 : m_ranks[node]; }
+
+  // OnOff sources and packet sinks for all flow lines, UDP unless marked tcp.
+  ApplicationContainer InstallFlows (uint16_t basePort = 1000) const;
+
+private:
+  void Parse (const std::string &filename);
+  void Build ();
+
+  Ipv4Address m_pool;
+  Ipv4Mask m_poolMask;
+  InternetStackHelper m_stackHelper;
+  uint32_t m_nodeCount;
+  NodeContainer m_nodes;
+  NetDeviceContainer m_devices;
+  std::vector<Link> m_links;
+  std::vector<Flow> m_flows;
+  std::vector<uint32_t> m_hosts;
+  std::vector<std::pair<uint32_t, uint32_t>> m_rankLines;  //!< (node, rank) as parsed
+  std::vector<uint32_t> m_ranks;                           //!< Rank by node id
+};
+
+} // namespace ns3
+
+#endif /* TOPOLOGY_LOADER_HELPER_H */
@@ -0,0 +1,130 @@
+#include "trace-matrix-helper.h"
+
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4.h"
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/trace-sender-application.h"
+#include "ns3/trace-probe-scheduler.h"
+
+#include <unordered_map>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TraceMatrixHelper");
+
+TraceMatrixHelper::TraceMatrixHelper (uint16_t port)
+  : m_port (port),
+    m_interval (20)
+{
+  m_senderFactory.SetTypeId ("ns3::TraceSender");
+  m_senderFactory.Set ("Protocol", StringValue ("ns3::UdpSocketFactory"));
+  m_receiverFactory.SetTypeId ("ns3::TraceReceiver");
+  m_receiverFactory.Set ("Protocol", StringValue ("ns3::UdpSocketFactory"));
+}
+
+void
+TraceMatrixHelper::SetSenderAttribute (std::string name, const AttributeValue &value)
+{
+  m_senderFactory.Set (name, value);
+}
+
+void
+TraceMatrixHelper::SetReceiverAttribute (std::string name, const AttributeValue &value)
+{
+  m_receiverFactory.Set (name, value);
+}
+
+void
+TraceMatrixHelper::SetProbeInterval (uint32_t intervalMs)
+{
+  m_interval = intervalMs;
+  m_senderFactory.Set ("ProbeInterval", UintegerValue (intervalMs));
+}
+
+void
+TraceMatrixHelper::AddPair (Ptr<Node> from, Ptr<Node> to)
+{
+  NS_ABORT_MSG_IF (from == to, "TraceMatrixHelper: Source and destination of a pair must differ");
+  m_pairs.emplace_back (from, to);
+}
+
+void
+TraceMatrixHelper::AddAllPairs (NodeContainer nodes)
+{
+  m_pairs.reserve (m_pairs.size () + nodes.GetN () * (nodes.GetN () - 1));
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      for (uint32_t j = 0; j < nodes.GetN (); j++)
+        {
+          if (i != j)
+            {
+              AddPair (nodes.Get (i), nodes.Get (j));
+            }
+        }
+    }
+}
+
+ApplicationContainer
+TraceMatrixHelper::Install ()
+{
+  std::unordered_map<uint32_t, Ptr<TraceProbeScheduler>> schedulers;
+  std::unordered_map<uint32_t, Address> receivers;
+
+  for (const auto &pair : m_pairs)
+    {
+      Ptr<Node> from = pair.first;
+      Ptr<Node> to = pair.second;
+
+      // Distributed runs only install applications of the local rank.
+      auto receiver = receivers.find (to->GetId ());
+      if (receiver == receivers.end ())
+        {
+          Address address (InetSocketAddress (to->GetObject<Ipv4> ()->GetAddress (1, 0).GetLocal (), m_port));
+          if (to->GetSystemId () == Simulator::GetSystemId ())
+            {
+              m_receiverFactory.Set ("Local", AddressValue (address));
+              Ptr<Application> app = m_receiverFactory.Create<Application> ();
+              to->AddApplication (app);
+              m_receivers.Add (app);
+            }
+          receiver = receivers.emplace (to->GetId (), address).first;
+        }
+
+      if (from->GetSystemId () != Simulator::GetSystemId ())
+        {
+          continue;
+        }
+
+      Ptr<TraceProbeScheduler> &scheduler = schedulers[from->GetId ()];
+      if (!scheduler)
+        {
+          scheduler = CreateObject<TraceProbeScheduler> ();
+          scheduler->SetAttribute ("ProbeInterval", UintegerValue (m_interval));
+          from->AddApplication (scheduler);
+          m_schedulers.Add (scheduler);
+        }
+
+      m_senderFactory.Set ("Remote", AddressValue (receiver->second));
+      m_senderFactory.Set ("FromNode", UintegerValue (from->GetId ()));
+      m_senderFactory.Set ("ToNode", UintegerValue (to->GetId ()));
+      Ptr<TraceSender> sender = m_senderFactory.Create<TraceSender> ();
+      from->AddApplication (sender);
+      scheduler->AddSender (sender);
+      m_senders.Add (sender);
+    }
+
+  NS_LOG_INFO ("Installed " << m_pairs.size () << " trace pairs with " << m_schedulers.GetN ()
+               << " probe schedulers and " << m_receivers.GetN () << " receivers");
+
+  ApplicationContainer apps;
+  apps.Add (m_schedulers);
+  apps.Add (m_senders);
+  apps.Add (m_receivers);
+  return apps;
+}
+
+} // namespace ns3
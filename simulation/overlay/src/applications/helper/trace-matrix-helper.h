@@ -0,0 +1,57 @@
+#ifndef TRACE_MATRIX_HELPER_H
+#define TRACE_MATRIX_HELPER_H
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ns3/object-factory.h"
+#include "ns3/attribute.h"
+#include "ns3/node-container.h"
+#include "ns3/application-container.h"
+
+namespace ns3 {
+
+/**
+ * Installs trace probing for a set of (source, destination) node pairs in a
+ * single simulation.
+ *
+ * Every pair gets its own TraceSender and therefore its own trace file.
+ * All senders of a source node are driven by one TraceProbeScheduler, and
+ * every destination node gets one TraceReceiver on the shared port.
+ */
+class TraceMatrixHelper
+{
+public:
+  TraceMatrixHelper (uint16_t port = 1020);
+  void SetSenderAttribute (std::string name, const AttributeValue &value);
+  void SetReceiverAttribute (std::string name, const AttributeValue &value);
+  void SetProbeInterval (uint32_t intervalMs);
+
+  void AddPair (Ptr<Node> from, Ptr<Node> to);
+  // Adds both directions between every two nodes of the container.
+  void AddAllPairs (NodeContainer nodes);
+  size_t GetNPairs () const { return m_pairs.size (); }
+
+  // Installs schedulers, senders and receivers, returns all of them.
+  ApplicationContainer Install ();
+
+  ApplicationContainer GetSenders () const { return m_senders; }
+  ApplicationContainer GetReceivers () const { return m_receivers; }
+  ApplicationContainer GetSchedulers () const { return m_schedulers; }
+
+private:
+  uint16_t m_port;
+  uint32_t m_interval;
+  ObjectFactory m_senderFactory;
+  ObjectFactory m_receiverFactory;
+  std::vector<std::pair<Ptr<Node>, Ptr<Node>>> m_pairs;
+
+  ApplicationContainer m_senders;
+  ApplicationContainer m_receivers;
+  ApplicationContainer m_schedulers;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_MATRIX_HELPER_H */
@@ -0,0 +1,91 @@
+#include "counting-scheduler.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/object-factory.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("CountingScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (CountingScheduler);
+
+CountingScheduler *CountingScheduler::s_active = 0;
+
+TypeId
+CountingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::CountingScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<CountingScheduler> ()
+    .AddAttribute ("Scheduler",
+                   "Scheduler that holds the events",
+                   TypeIdValue (MapScheduler::GetTypeId ()),
+                   MakeTypeIdAccessor (&CountingScheduler::SetScheduler),
+                   MakeTypeIdChecker ())
+  ;
+  return tid;
+}
+
+CountingScheduler::CountingScheduler ()
+  : m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+  s_active = this;
+}
+
+CountingScheduler::~CountingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+  if (s_active == this)
+    {
+      s_active = 0;
+    }
+}
+
+void
+CountingScheduler::SetScheduler (TypeId type)
+{
+  NS_ABORT_MSG_IF (type == GetTypeId (), "CountingScheduler: Can not wrap itself");
+  NS_ABORT_MSG_IF (m_size != 0, "CountingScheduler: Scheduler changed while holding events");
+  ObjectFactory factory;
+  factory.SetTypeId (type);
+  m_scheduler = factory.Create<Scheduler> ();
+}
+
+void
+CountingScheduler::Insert (const Event &ev)
+{
+  m_scheduler->Insert (ev);
+  m_size++;
+}
+
+bool
+CountingScheduler::IsEmpty (void) const
+{
+  return m_scheduler->IsEmpty ();
+}
+
+Scheduler::Event
+CountingScheduler::PeekNext (void) const
+{
+  return m_scheduler->PeekNext ();
+}
+
+Scheduler::Event
+CountingScheduler::RemoveNext (void)
+{
+  m_size--;
+  return m_scheduler->RemoveNext ();
+}
+
+void
+CountingScheduler::Remove (const Event &ev)
+{
+  m_scheduler->Remove (ev);
+  m_size--;
+}
+
+} // namespace ns3
@@ -0,0 +1,52 @@
+#ifndef COUNTING_SCHEDULER_H
+#define COUNTING_SCHEDULER_H
+
+#include "ns3/ptr.h"
+#include "ns3/scheduler.h"
+#include "ns3/type-id.h"
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Event scheduler that forwards to another scheduler and counts the events
+ * it holds, one increment or decrement per operation.
+ *
+ * Ns-3 does not expose the scheduler of the running simulation, so the
+ * newest instance registers itself and GetActive returns it.
+ * SimulationTelemetry swaps it in for the configured SchedulerType when it
+ * starts, the event order does not change.
+ */
+class CountingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  CountingScheduler ();
+  virtual ~CountingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+  // Events in the scheduler, including cancelled ones not removed yet.
+  uint64_t GetSize (void) const { return m_size; }
+
+  // Scheduler of the running simulation, 0 if it is not a CountingScheduler.
+  static CountingScheduler *GetActive (void) { return s_active; }
+
+private:
+  void SetScheduler (TypeId type);
+
+  Ptr<Scheduler> m_scheduler;
+  uint64_t m_size;
+
+  static CountingScheduler *s_active;
+};
+
+} // namespace ns3
+
+#endif /* COUNTING_SCHEDULER_H */
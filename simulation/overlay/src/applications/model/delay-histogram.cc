@@ -0,0 +1,53 @@
+#include "delay-histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3 {
+
+void
+DelayHistogram::Merge(const DelayHistogram& other) {
+  if (other.m_count == 0) {
+    return;
+  }
+
+  for (uint32_t index = other.m_lowIndex; index <= other.m_highIndex; index++) {
+    m_counts[index] += other.m_counts[index];
+  }
+  m_count += other.m_count;
+  m_max = std::max(m_max, other.m_max);
+  m_lowIndex = std::min(m_lowIndex, other.m_lowIndex);
+  m_highIndex = std::max(m_highIndex, other.m_highIndex);
+}
+
+void
+DelayHistogram::Reset() {
+  if (m_count != 0) {
+    std::fill(m_counts + m_lowIndex, m_counts + m_highIndex + 1, 0);
+  }
+  m_count = 0;
+  m_max = 0;
+  m_lowIndex = DELAY_BUCKETS;
+  m_highIndex = 0;
+}
+
+uint64_t
+DelayHistogram::Percentile(double p) const {
+  if (m_count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * m_count));
+  rank = std::min(std::max<uint64_t>(rank, 1), m_count);
+
+  uint64_t seen = 0;
+  for (uint32_t index = m_lowIndex; index <= m_highIndex; index++) {
+    seen += m_counts[index];
+    if (seen >= rank) {
+      return std::min(LowerBound(index) + Width(index) / 2, m_max);
+    }
+  }
+  return m_max;
+}
+
+} // namespace ns3
@@ -0,0 +1,80 @@
+#ifndef DELAY_HISTOGRAM_H
+#define DELAY_HISTOGRAM_H
+
+#include <cstdint>
+#include <cstddef>
+
+namespace ns3 {
+
+// Every power of two range is split into 2^DELAY_SUB_BUCKET_BITS linear
+// sub-buckets, which bounds the relative error of a percentile to ~1.6%.
+#define DELAY_SUB_BUCKET_BITS 5
+#define DELAY_SUB_BUCKETS (1u << DELAY_SUB_BUCKET_BITS)
+#define DELAY_BUCKETS ((64 - DELAY_SUB_BUCKET_BITS + 1) * DELAY_SUB_BUCKETS)
+
+/**
+ * Log-bucketed histogram of delay samples with a fixed footprint.
+ *
+ * Values below DELAY_SUB_BUCKETS are counted exactly. Histograms merge by
+ * adding their counts, so block histograms can be folded into a run total.
+ */
+class DelayHistogram {
+public:
+  DelayHistogram() : m_count(0), m_max(0), m_lowIndex(DELAY_BUCKETS), m_highIndex(0) {
+    for (uint32_t& count : m_counts) {
+      count = 0;
+    }
+  }
+
+  void Add(uint64_t value) {
+    uint32_t index = IndexOf(value);
+    m_counts[index]++;
+    m_count++;
+    if (value > m_max) m_max = value;
+    if (index < m_lowIndex) m_lowIndex = index;
+    if (index > m_highIndex) m_highIndex = index;
+  }
+
+  void Merge(const DelayHistogram& other);
+
+  // Only clears the range of buckets that was used.
+  void Reset();
+
+  uint64_t Count() const { return m_count; }
+  uint64_t Max() const { return m_max; }
+
+  // Value at percentile p (0-100), the midpoint of its bucket capped at Max().
+  uint64_t Percentile(double p) const;
+
+  static uint32_t IndexOf(uint64_t value) {
+    if (value < DELAY_SUB_BUCKETS) {
+      return static_cast<uint32_t>(value);
+    }
+    uint32_t msb = 63 - __builtin_clzll(value);
+    uint32_t shift = msb - DELAY_SUB_BUCKET_BITS;
+    return (shift + 1) * DELAY_SUB_BUCKETS + static_cast<uint32_t>((value >> shift) & (DELAY_SUB_BUCKETS - 1));
+  }
+
+  static uint64_t LowerBound(uint32_t index) {
+    if (index < DELAY_SUB_BUCKETS) {
+      return index;
+    }
+    uint32_t shift = index / DELAY_SUB_BUCKETS - 1;
+    return static_cast<uint64_t>(DELAY_SUB_BUCKETS + index % DELAY_SUB_BUCKETS) << shift;
+  }
+
+  static uint64_t Width(uint32_t index) {
+    return index < DELAY_SUB_BUCKETS ? 1 : 1ULL << (index / DELAY_SUB_BUCKETS - 1);
+  }
+
+private:
+  uint32_t m_counts[DELAY_BUCKETS];
+  uint64_t m_count;
+  uint64_t m_max;
+  uint32_t m_lowIndex;
+  uint32_t m_highIndex;
+};
+
+} // namespace ns3
+
+#endif /* DELAY_HISTOGRAM_H */
@@ -0,0 +1,299 @@
+#include "flat-routing-table.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4.h"
+#include "ns3/log.h"
+#include "ns3/node-list.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("FlatRoutingTable");
+
+FlatRoutingTable::FlatRoutingTable ()
+  : m_nodes (0),
+    m_built (false),
+    m_deferUpdates (false),
+    m_recomputed (0)
+{
+}
+
+void
+FlatRoutingTable::Build ()
+{
+  Reset (NodeList::GetNNodes ());
+
+  for (uint32_t id = 0; id < m_nodes; id++)
+    {
+      Ptr<Ipv4> ipv4 = NodeList::GetNode (id)->GetObject<Ipv4> ();
+      if (!ipv4)
+        {
+          continue;
+        }
+
+      for (uint32_t i = 1; i < ipv4->GetNInterfaces (); i++)
+        {
+          if (ipv4->GetNAddresses (i) == 0)
+            {
+              continue;
+            }
+          Ipv4Address local = ipv4->GetAddress (i, 0).GetLocal ();
+          AddAddress (local, id);
+
+          Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice> (ipv4->GetNetDevice (i));
+          if (!device || !device->GetChannel ())
+            {
+              continue;
+            }
+
+          Ptr<PointToPointChannel> channel = DynamicCast<PointToPointChannel> (device->GetChannel ());
+          Ptr<NetDevice> peer = channel->GetDevice (0) == device ? channel->GetDevice (1) : channel->GetDevice (0);
+          uint32_t peerId = peer->GetNode ()->GetId ();
+
+          // Every link is added once, from its lower node id.
+          if (peerId < id)
+            {
+              continue;
+            }
+
+          Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+          int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice (peer) : -1;
+          if (peerInterface < 0 || peerIpv4->GetNAddresses (peerInterface) == 0)
+            {
+              continue;
+            }
+
+          bool up = ipv4->IsUp (i) && peerIpv4->IsUp (peerInterface);
+          AddLink (id, i, local, peerId, peerInterface, peerIpv4->GetAddress (peerInterface, 0).GetLocal (), up);
+        }
+    }
+
+  Finalize ();
+}
+
+void
+FlatRoutingTable::Reset (uint32_t nodes)
+{
+  NS_ABORT_MSG_IF (nodes >= UNREACHABLE, "FlatRoutingTable: Too many nodes for 16 bit hop counts");
+  m_nodes = nodes;
+  m_built = false;
+  m_pending.clear ();
+  m_adjOffset.clear ();
+  m_adj.clear ();
+  m_linkUp.clear ();
+  m_linkAdj.clear ();
+  m_changedLinks.clear ();
+  m_column.assign (nodes, NO_COLUMN);
+  m_destinations.clear ();
+  m_next.clear ();
+  m_dist.clear ();
+  m_addressToNode.clear ();
+}
+
+void
+FlatRoutingTable::AddLink (uint32_t a, uint32_t aInterface, Ipv4Address aAddress,
+                           uint32_t b, uint32_t bInterface, Ipv4Address bAddress, bool up)
+{
+  NS_ABORT_MSG_IF (a >= m_nodes || b >= m_nodes, "FlatRoutingTable: Link " << a << " - " << b << " outside of table");
+  m_pending.push_back ({a, aInterface, b, bInterface, aAddress, bAddress, up});
+}
+
+void
+FlatRoutingTable::AddAddress (Ipv4Address address, uint32_t node)
+{
+  m_addressToNode[address.Get ()] = node;
+}
+
+void
+FlatRoutingTable::Finalize ()
+{
+  // Counting sort of both directions of every link into the adjacency array.
+  m_adjOffset.assign (m_nodes + 1, 0);
+  for (const PendingLink &link : m_pending)
+    {
+      m_adjOffset[link.a + 1]++;
+      m_adjOffset[link.b + 1]++;
+    }
+  for (uint32_t node = 0; node < m_nodes; node++)
+    {
+      NS_ABORT_MSG_IF (m_adjOffset[node + 1] >= NO_ROUTE, "FlatRoutingTable: Node " << node << " has too many links");
+      m_adjOffset[node + 1] += m_adjOffset[node];
+    }
+
+  std::vector<uint32_t> fill (m_adjOffset.begin (), m_adjOffset.end () - 1);
+  m_adj.resize (m_pending.size () * 2);
+  m_linkUp.resize (m_pending.size ());
+  m_linkAdj.resize (m_pending.size ());
+  for (uint32_t link = 0; link < m_pending.size (); link++)
+    {
+      const PendingLink &pending = m_pending[link];
+      uint32_t forward = fill[pending.a]++;
+      uint32_t backward = fill[pending.b]++;
+      m_adj[forward] = {pending.b, pending.aInterface, backward, link, pending.bAddress};
+      m_adj[backward] = {pending.a, pending.bInterface, forward, link, pending.aAddress};
+      m_linkUp[link] = pending.up;
+      m_linkAdj[link] = forward;
+    }
+  m_pending.clear ();
+  m_pending.shrink_to_fit ();
+
+  m_column.assign (m_nodes, NO_COLUMN);
+  m_destinations.clear ();
+  m_next.clear ();
+  m_dist.clear ();
+  m_queue.reserve (m_nodes);
+  m_built = true;
+
+  NS_LOG_INFO ("Flat routing table for " << m_nodes << " nodes and " << m_linkUp.size () << " links, "
+               << (m_nodes * 2 * sizeof (uint16_t)) / 1024 << " KiB per routed destination");
+}
+
+uint32_t
+FlatRoutingTable::AddColumn (uint32_t destination)
+{
+  NS_ABORT_MSG_IF (!m_built, "FlatRoutingTable: Lookup before the table was built");
+  uint32_t column = m_destinations.size ();
+  m_column[destination] = column;
+  m_destinations.push_back (destination);
+  m_next.resize (m_next.size () + m_nodes);
+  m_dist.resize (m_dist.size () + m_nodes);
+  ComputeColumn (column);
+  return column;
+}
+
+void
+FlatRoutingTable::ComputeColumn (uint32_t column)
+{
+  uint32_t destination = m_destinations[column];
+  uint16_t *next = &m_next[static_cast<size_t> (column) * m_nodes];
+  uint16_t *dist = &m_dist[static_cast<size_t> (column) * m_nodes];
+  std::fill (next, next + m_nodes, NO_ROUTE);
+  std::fill (dist, dist + m_nodes, UNREACHABLE);
+
+  m_queue.clear ();
+  m_queue.push_back (destination);
+  dist[destination] = 0;
+  for (size_t head = 0; head < m_queue.size (); head++)
+    {
+      uint32_t node = m_queue[head];
+      for (uint32_t index = m_adjOffset[node]; index < m_adjOffset[node + 1]; index++)
+        {
+          const Adjacency &adjacency = m_adj[index];
+          if (!m_linkUp[adjacency.link] || dist[adjacency.neighbor] != UNREACHABLE)
+            {
+              continue;
+            }
+
+          // The neighbor reaches the destination over the reverse direction.
+          dist[adjacency.neighbor] = dist[node] + 1;
+          next[adjacency.neighbor] = static_cast<uint16_t> (adjacency.reverse - m_adjOffset[adjacency.neighbor]);
+          m_queue.push_back (adjacency.neighbor);
+        }
+    }
+  m_recomputed++;
+}
+
+std::vector<uint32_t>
+FlatRoutingTable::GetPath (uint32_t from, uint32_t to)
+{
+  std::vector<uint32_t> path;
+  if (GetHops (from, to) == UNREACHABLE)
+    {
+      return path;
+    }
+
+  path.push_back (from);
+  while (from != to)
+    {
+      from = Lookup (from, to)->neighbor;
+      path.push_back (from);
+    }
+  return path;
+}
+
+void
+FlatRoutingTable::SetInterfaceState (uint32_t node, uint32_t interface, bool up)
+{
+  if (!m_built || node >= m_nodes)
+    {
+      return;
+    }
+
+  for (uint32_t index = m_adjOffset[node]; index < m_adjOffset[node + 1]; index++)
+    {
+      uint32_t link = m_adj[index].link;
+      if (m_adj[index].interface != interface || m_linkUp[link] == up)
+        {
+          continue;
+        }
+
+      m_linkUp[link] = up;
+      m_changedLinks.push_back (link);
+    }
+
+  if (!m_deferUpdates)
+    {
+      ApplyUpdates ();
+    }
+}
+
+void
+FlatRoutingTable::SetDeferUpdates (bool defer)
+{
+  m_deferUpdates = defer;
+  if (!defer)
+    {
+      ApplyUpdates ();
+    }
+}
+
+void
+FlatRoutingTable::ApplyUpdates ()
+{
+  if (m_changedLinks.empty ())
+    {
+      return;
+    }
+
+  // Decide on the tables from before the change which columns can differ.
+  // Only routed destinations have a column, the others are computed with
+  // the new link states on first use.
+  std::vector<bool> affected (m_destinations.size (), false);
+  for (uint32_t link : m_changedLinks)
+    {
+      uint32_t forward = m_linkAdj[link];
+      uint32_t a = m_adj[m_adj[forward].reverse].neighbor;
+      uint32_t b = m_adj[forward].neighbor;
+      uint32_t aSlot = forward - m_adjOffset[a];
+      uint32_t bSlot = m_adj[forward].reverse - m_adjOffset[b];
+
+      for (uint32_t column = 0; column < m_destinations.size (); column++)
+        {
+          size_t start = static_cast<size_t> (column) * m_nodes;
+          if (m_linkUp[link])
+            {
+              affected[column] = affected[column] || m_dist[start + a] != m_dist[start + b];
+            }
+          else
+            {
+              affected[column] = affected[column] || m_next[start + a] == aSlot || m_next[start + b] == bSlot;
+            }
+        }
+    }
+  m_changedLinks.clear ();
+
+  uint64_t before = m_recomputed;
+  for (uint32_t column = 0; column < m_destinations.size (); column++)
+    {
+      if (affected[column])
+        {
+          ComputeColumn (column);
+        }
+    }
+  NS_LOG_INFO ("Recomputed " << m_recomputed - before << " of " << m_destinations.size () << " routed destinations");
+}
+
+} // namespace ns3
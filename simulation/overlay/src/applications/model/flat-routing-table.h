@@ -0,0 +1,129 @@
+#ifndef FLAT_ROUTING_TABLE_H
+#define FLAT_ROUTING_TABLE_H
+
+#include "ns3/ipv4-address.h"
+#include "ns3/simple-ref-count.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * All-pairs next hop table shared by every Ipv4FlatRouting instance.
+ *
+ * The topology is kept as a compressed adjacency list of point-to-point
+ * links. Paths are hop count shortest paths, one BFS per destination, ties
+ * go to the neighbor found first. Next hops and distances are stored
+ * destination-major in flat uint16_t arrays, so a lookup is one index
+ * computation and a BFS writes one contiguous column.
+ *
+ * A destination gets its column with the first lookup towards it, so the
+ * table takes 4 bytes per node for every destination that is routed to,
+ * 4 * nodes^2 bytes only if every node is.
+ *
+ * When links go down or come up only the routed destinations whose BFS tree
+ * can change are recomputed: for a failed link those whose tree used it,
+ * for a restored link those whose distances differ at its two ends. The
+ * result is identical to recomputing every destination.
+ */
+class FlatRoutingTable : public SimpleRefCount<FlatRoutingTable>
+{
+public:
+  static constexpr uint16_t NO_ROUTE = UINT16_MAX;
+  static constexpr uint16_t UNREACHABLE = UINT16_MAX;
+  static constexpr uint32_t NO_NODE = UINT32_MAX;
+  static constexpr uint32_t NO_COLUMN = UINT32_MAX;
+
+  struct Adjacency {
+    uint32_t neighbor;
+    uint32_t interface;   //!< Outgoing interface on the owning node
+    uint32_t reverse;     //!< Index of the opposite direction in the adjacency array
+    uint32_t link;
+    Ipv4Address gateway;  //!< Address of the neighbor on this link
+  };
+
+  FlatRoutingTable ();
+
+  // Reads all point-to-point links of the nodes in NodeList.
+  void Build ();
+
+  void Reset (uint32_t nodes);
+  void AddLink (uint32_t a, uint32_t aInterface, Ipv4Address aAddress,
+                uint32_t b, uint32_t bInterface, Ipv4Address bAddress, bool up = true);
+  void AddAddress (Ipv4Address address, uint32_t node);
+  // Builds the adjacency arrays, destinations are computed on demand.
+  void Finalize ();
+
+  bool IsBuilt () const { return m_built; }
+  uint32_t GetNNodes () const { return m_nodes; }
+
+  const Adjacency *Lookup (uint32_t from, uint32_t to) {
+    uint16_t slot = m_next[GetColumn (to) + from];
+    return slot == NO_ROUTE ? nullptr : &m_adj[m_adjOffset[from] + slot];
+  }
+
+  uint32_t FindNode (Ipv4Address address) const {
+    auto it = m_addressToNode.find (address.Get ());
+    return it == m_addressToNode.end () ? NO_NODE : it->second;
+  }
+
+  uint16_t GetHops (uint32_t from, uint32_t to) {
+    return m_dist[GetColumn (to) + from];
+  }
+
+  // Nodes from source to destination, both included, empty if unreachable.
+  std::vector<uint32_t> GetPath (uint32_t from, uint32_t to);
+
+  // Marks the link behind an interface up or down. Unless updates are
+  // deferred the affected destinations are recomputed right away.
+  void SetInterfaceState (uint32_t node, uint32_t interface, bool up);
+  void SetDeferUpdates (bool defer);
+  void ApplyUpdates ();
+
+  uint64_t GetRecomputedDestinations () const { return m_recomputed; }
+  // Destinations routed to so far, each takes 4 bytes per node.
+  uint32_t GetNRoutedDestinations () const { return m_destinations.size (); }
+
+private:
+  struct PendingLink {
+    uint32_t a, aInterface, b, bInterface;
+    Ipv4Address aAddress, bAddress;
+    bool up;
+  };
+
+  // Start of the column of a destination, computed on first use.
+  size_t GetColumn (uint32_t to) {
+    uint32_t column = m_column[to];
+    if (column == NO_COLUMN)
+      {
+        column = AddColumn (to);
+      }
+    return static_cast<size_t> (column) * m_nodes;
+  }
+  uint32_t AddColumn (uint32_t destination);
+  void ComputeColumn (uint32_t column);
+
+  uint32_t m_nodes;
+  bool m_built;
+  bool m_deferUpdates;
+  uint64_t m_recomputed;                  //!< Destinations computed so far
+  std::vector<PendingLink> m_pending;     //!< Links added before Finalize
+  std::vector<uint32_t> m_adjOffset;      //!< Start of each node in m_adj, size nodes + 1
+  std::vector<Adjacency> m_adj;
+  std::vector<bool> m_linkUp;
+  std::vector<uint32_t> m_linkAdj;        //!< Adjacency of each link as seen from its first node
+  std::vector<uint32_t> m_changedLinks;   //!< Links changed since the last update
+  std::vector<uint32_t> m_column;         //!< Column of each destination, NO_COLUMN until routed to
+  std::vector<uint32_t> m_destinations;   //!< Destination of each column
+  std::vector<uint16_t> m_next;           //!< [column * nodes + from] slot in the adjacency of from
+  std::vector<uint16_t> m_dist;           //!< [column * nodes + from] hop count
+  std::vector<uint32_t> m_queue;          //!< BFS queue, kept to avoid reallocation
+  std::unordered_map<uint32_t, uint32_t> m_addressToNode;
+};
+
+} // namespace ns3
+
+#endif /* FLAT_ROUTING_TABLE_H */
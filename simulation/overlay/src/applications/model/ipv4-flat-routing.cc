@@ -0,0 +1,223 @@
+#include "ipv4-flat-routing.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/simulator.h"
+
+#include <iomanip>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("Ipv4FlatRouting");
+
+NS_OBJECT_ENSURE_REGISTERED (Ipv4FlatRouting);
+
+TypeId
+Ipv4FlatRouting::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::Ipv4FlatRouting")
+    .SetParent<Ipv4RoutingProtocol> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<Ipv4FlatRouting> ()
+  ;
+  return tid;
+}
+
+Ipv4FlatRouting::Ipv4FlatRouting ()
+  : m_nodeId (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+Ipv4FlatRouting::~Ipv4FlatRouting ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+Ipv4FlatRouting::DoDispose (void)
+{
+  m_ipv4 = 0;
+  m_table = 0;
+  Ipv4RoutingProtocol::DoDispose ();
+}
+
+Ptr<Ipv4Route>
+Ipv4FlatRouting::Lookup (Ipv4Address destination, Ptr<const NetDevice> oif) const
+{
+  if (!m_table || !m_table->IsBuilt ())
+    {
+      return 0;
+    }
+
+  uint32_t to = m_table->FindNode (destination);
+  if (to == FlatRoutingTable::NO_NODE)
+    {
+      return 0;
+    }
+
+  const FlatRoutingTable::Adjacency *next = m_table->Lookup (m_nodeId, to);
+  if (!next)
+    {
+      return 0;
+    }
+
+  Ptr<NetDevice> device = m_ipv4->GetNetDevice (next->interface);
+  if (oif && oif != device)
+    {
+      return 0;
+    }
+
+  Ptr<Ipv4Route> route = Create<Ipv4Route> ();
+  route->SetDestination (destination);
+  route->SetGateway (next->gateway);
+  route->SetSource (m_ipv4->GetAddress (next->interface, 0).GetLocal ());
+  route->SetOutputDevice (device);
+  return route;
+}
+
+Ptr<Ipv4Route>
+Ipv4FlatRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                              Socket::SocketErrno &sockerr)
+{
+  Ipv4Address destination = header.GetDestination ();
+  if (destination.IsMulticast () || destination.IsBroadcast ())
+    {
+      sockerr = Socket::ERROR_NOROUTETOHOST;
+      return 0;
+    }
+
+  Ptr<Ipv4Route> route = Lookup (destination, oif);
+  sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+  return route;
+}
+
+bool
+Ipv4FlatRouting::RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                             const UnicastForwardCallback &ucb, const MulticastForwardCallback &mcb,
+                             const LocalDeliverCallback &lcb, const ErrorCallback &ecb)
+{
+  // Local delivery is done by Ipv4ListRouting before any protocol is asked.
+  Ipv4Address destination = header.GetDestination ();
+  if (destination.IsMulticast () || destination.IsBroadcast ())
+    {
+      return false;
+    }
+
+  if (m_ipv4->IsForwarding (m_ipv4->GetInterfaceForDevice (idev)) == false)
+    {
+      NS_LOG_LOGIC ("Forwarding disabled for this interface");
+      ecb (p, header, Socket::ERROR_NOROUTETOHOST);
+      return true;
+    }
+
+  Ptr<Ipv4Route> route = Lookup (destination, 0);
+  if (!route)
+    {
+      return false;
+    }
+  ucb (route, p, header);
+  return true;
+}
+
+bool
+Ipv4FlatRouting::IsLinkUp (uint32_t interface) const
+{
+  if (!m_ipv4->IsUp (interface))
+    {
+      return false;
+    }
+
+  Ptr<PointToPointNetDevice> device = DynamicCast<PointToPointNetDevice> (m_ipv4->GetNetDevice (interface));
+  if (!device || !device->GetChannel ())
+    {
+      return true;
+    }
+  Ptr<PointToPointChannel> channel = DynamicCast<PointToPointChannel> (device->GetChannel ());
+  Ptr<NetDevice> peer = channel->GetDevice (0) == device ? channel->GetDevice (1) : channel->GetDevice (0);
+  Ptr<Ipv4> peerIpv4 = peer->GetNode ()->GetObject<Ipv4> ();
+  int32_t peerInterface = peerIpv4 ? peerIpv4->GetInterfaceForDevice (peer) : -1;
+  return peerInterface >= 0 && peerIpv4->IsUp (peerInterface);
+}
+
+void
+Ipv4FlatRouting::NotifyInterfaceUp (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (m_table && IsLinkUp (interface))
+    {
+      m_table->SetInterfaceState (m_nodeId, interface, true);
+    }
+}
+
+void
+Ipv4FlatRouting::NotifyInterfaceDown (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (m_table)
+    {
+      m_table->SetInterfaceState (m_nodeId, interface, false);
+    }
+}
+
+void
+Ipv4FlatRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+  // Addresses are read when the shared table is built.
+}
+
+void
+Ipv4FlatRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+void
+Ipv4FlatRouting::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  NS_ASSERT (!m_ipv4 && ipv4);
+  m_ipv4 = ipv4;
+  // The stack is aggregated to its node before the routing protocol is set.
+  Ptr<Node> node = ipv4->GetObject<Node> ();
+  NS_ABORT_MSG_IF (!node, "Ipv4FlatRouting: Ipv4 without a node");
+  m_nodeId = node->GetId ();
+}
+
+void
+Ipv4FlatRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+  std::ostream *os = stream->GetStream ();
+  uint32_t from = m_nodeId;
+
+  *os << "Node: " << from << ", Time: " << Now ().As (unit)
+      << ", Local time: " << m_ipv4->GetObject<Node> ()->GetLocalTime ().As (unit)
+      << ", Ipv4FlatRouting table" << std::endl;
+  if (!m_table || !m_table->IsBuilt ())
+    {
+      *os << "Table not built" << std::endl;
+      return;
+    }
+
+  // Lists every destination, so all of them get a column in the shared table.
+  *os << "Node     Gateway         Iface Hops" << std::endl;
+  for (uint32_t to = 0; to < m_table->GetNNodes (); to++)
+    {
+      const FlatRoutingTable::Adjacency *next = m_table->Lookup (from, to);
+      if (!next)
+        {
+          continue;
+        }
+      std::ostringstream gateway;
+      gateway << next->gateway;
+      *os << std::setiosflags (std::ios::left) << std::setw (9) << to << std::setw (16) << gateway.str ()
+          << std::setw (6) << next->interface << m_table->GetHops (from, to) << std::endl;
+    }
+  *os << std::endl;
+}
+
+} // namespace ns3
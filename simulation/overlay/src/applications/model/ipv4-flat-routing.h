@@ -0,0 +1,58 @@
+#ifndef IPV4_FLAT_ROUTING_H
+#define IPV4_FLAT_ROUTING_H
+
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ptr.h"
+
+#include "flat-routing-table.h"
+
+namespace ns3 {
+
+/**
+ * Unicast routing from a FlatRoutingTable shared by all nodes.
+ *
+ * Meant to sit below Ipv4StaticRouting in an Ipv4ListRouting, which keeps
+ * handling loopback and broadcast. A lookup maps the destination address to
+ * its node and reads the next hop of this node from the shared table, no
+ * per-node route list is kept.
+ */
+class Ipv4FlatRouting : public Ipv4RoutingProtocol
+{
+public:
+  static TypeId GetTypeId (void);
+  Ipv4FlatRouting ();
+  virtual ~Ipv4FlatRouting ();
+
+  void SetTable (Ptr<FlatRoutingTable> table) { m_table = table; }
+  Ptr<FlatRoutingTable> GetTable (void) const { return m_table; }
+
+  Ptr<Ipv4Route> RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDevice> oif,
+                              Socket::SocketErrno &sockerr) override;
+  bool RouteInput (Ptr<const Packet> p, const Ipv4Header &header, Ptr<const NetDevice> idev,
+                   const UnicastForwardCallback &ucb, const MulticastForwardCallback &mcb,
+                   const LocalDeliverCallback &lcb, const ErrorCallback &ecb) override;
+  void NotifyInterfaceUp (uint32_t interface) override;
+  void NotifyInterfaceDown (uint32_t interface) override;
+  void NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address) override;
+  void NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address) override;
+  void SetIpv4 (Ptr<Ipv4> ipv4) override;
+  void PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit unit = Time::S) const override;
+
+protected:
+  void DoDispose (void) override;
+
+private:
+  Ptr<Ipv4Route> Lookup (Ipv4Address destination, Ptr<const NetDevice> oif) const;
+  // True if the interface and the one at the other end of its link are up.
+  bool IsLinkUp (uint32_t interface) const;
+
+  Ptr<Ipv4> m_ipv4;
+  uint32_t m_nodeId;   //!< Id of the node of m_ipv4, the row of the shared table
+  Ptr<FlatRoutingTable> m_table;
+};
+
+} // namespace ns3
+
+#endif /* IPV4_FLAT_ROUTING_H */
@@ -0,0 +1,240 @@
+#include "link-schedule-driver.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/data-rate.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-global-routing-helper.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LinkScheduleDriver");
+
+NS_OBJECT_ENSURE_REGISTERED (LinkScheduleDriver);
+
+TypeId
+LinkScheduleDriver::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LinkScheduleDriver")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<LinkScheduleDriver> ()
+    .AddAttribute ("RecomputeGlobalRouting",
+                   "Recompute global routing after links went down or came up",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&LinkScheduleDriver::m_recomputeGlobalRouting),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+LinkScheduleDriver::LinkScheduleDriver ()
+  : m_next (0),
+    m_recomputeGlobalRouting (false)
+{
+  NS_LOG_FUNCTION (this);
+
+  // Resolve the channel delay attribute once instead of by name per change.
+  TypeId::AttributeInformation info;
+  bool found = PointToPointChannel::GetTypeId ().LookupAttributeByName ("Delay", &info);
+  NS_ABORT_MSG_IF (!found, "LinkScheduleDriver: PointToPointChannel has no Delay attribute");
+  m_delayAccessor = info.accessor;
+}
+
+LinkScheduleDriver::~LinkScheduleDriver ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+LinkScheduleDriver::DoDispose (void)
+{
+  Simulator::Cancel (m_event);
+  m_links.clear ();
+  m_changes.clear ();
+  m_routingTable = 0;
+  Object::DoDispose ();
+}
+
+uint32_t
+LinkScheduleDriver::AddLink (Ptr<PointToPointNetDevice> a, Ptr<PointToPointNetDevice> b)
+{
+  NS_ABORT_MSG_IF (!a || !b || !a->GetChannel () || a->GetChannel () != b->GetChannel (),
+                   "LinkScheduleDriver: Devices of link " << m_links.size () << " are not connected");
+  LinkEnds link;
+  link.device[0] = a;
+  link.device[1] = b;
+  link.channel = DynamicCast<PointToPointChannel> (a->GetChannel ());
+  m_links.push_back (link);
+  return m_links.size () - 1;
+}
+
+void
+LinkScheduleDriver::AddLinks (const NetDeviceContainer &devices)
+{
+  NS_ABORT_MSG_IF (devices.GetN () % 2 != 0, "LinkScheduleDriver: Odd number of link devices");
+  for (uint32_t i = 0; i < devices.GetN (); i += 2)
+    {
+      AddLink (DynamicCast<PointToPointNetDevice> (devices.Get (i)),
+               DynamicCast<PointToPointNetDevice> (devices.Get (i + 1)));
+    }
+}
+
+void
+LinkScheduleDriver::AddChange (Time at, uint32_t link, ChangeType type, uint64_t value)
+{
+  NS_ABORT_MSG_IF (link >= m_links.size (), "LinkScheduleDriver: Unknown link " << link);
+  NS_ABORT_MSG_IF (at.IsNegative (), "LinkScheduleDriver: Negative change time");
+  m_changes.push_back ({static_cast<uint64_t> (at.GetNanoSeconds ()), value, link, type});
+}
+
+void
+LinkScheduleDriver::Load (const std::string &filename)
+{
+  std::ifstream file (filename);
+  NS_ABORT_MSG_IF (!file.is_open (), "LinkScheduleDriver: Unable to open link schedule " << filename);
+
+  std::string line;
+  uint32_t lineNo = 0;
+  size_t before = m_changes.size ();
+  while (std::getline (file, line))
+    {
+      lineNo++;
+      size_t comment = line.find ('#');
+      if (comment != std::string::npos)
+        {
+          line.erase (comment);
+        }
+
+      std::istringstream iss (line);
+      std::string at, action, value;
+      uint32_t link;
+      if (!(iss >> at))
+        {
+          continue;
+        }
+      NS_ABORT_MSG_IF (!(iss >> link >> action), "LinkScheduleDriver: Bad change in line " << lineNo);
+      NS_ABORT_MSG_IF (link >= m_links.size (), "LinkScheduleDriver: Unknown link " << link << " in line " << lineNo);
+
+      if (action == "rate" && iss >> value)
+        {
+          AddChange (Time (at), link, RATE, DataRate (value).GetBitRate ());
+        }
+      else if (action == "delay" && iss >> value)
+        {
+          AddChange (Time (at), link, DELAY, Time (value).GetNanoSeconds ());
+        }
+      else if (action == "down")
+        {
+          AddChange (Time (at), link, DOWN);
+        }
+      else if (action == "up")
+        {
+          AddChange (Time (at), link, UP);
+        }
+      else
+        {
+          NS_ABORT_MSG ("LinkScheduleDriver: Bad change in line " << lineNo);
+        }
+    }
+
+  NS_LOG_INFO ("Loaded " << m_changes.size () - before << " link changes from " << filename);
+}
+
+void
+LinkScheduleDriver::Start (void)
+{
+  // Stable, so changes of one instant keep their file order.
+  std::stable_sort (m_changes.begin (), m_changes.end (),
+                    [] (const Change &a, const Change &b) { return a.at < b.at; });
+  m_changes.shrink_to_fit ();
+  m_next = 0;
+
+  Simulator::Cancel (m_event);
+  if (!m_changes.empty ())
+    {
+      uint64_t now = Simulator::Now ().GetNanoSeconds ();
+      uint64_t first = std::max (m_changes.front ().at, now);
+      m_event = Simulator::Schedule (NanoSeconds (first - now), &LinkScheduleDriver::Apply, this);
+    }
+}
+
+void
+LinkScheduleDriver::SetLinkUp (const LinkEnds &link, bool up)
+{
+  for (const Ptr<PointToPointNetDevice> &device : link.device)
+    {
+      device->SetLinkUp (up);
+
+      // Routing follows the interface state, this notifies the protocols.
+      Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+      int32_t interface = ipv4 ? ipv4->GetInterfaceForDevice (device) : -1;
+      if (interface < 0 || ipv4->IsUp (interface) == up)
+        {
+          continue;
+        }
+      if (up)
+        {
+          ipv4->SetUp (interface);
+        }
+      else
+        {
+          ipv4->SetDown (interface);
+        }
+    }
+}
+
+void
+LinkScheduleDriver::Apply (void)
+{
+  uint64_t now = Simulator::Now ().GetNanoSeconds ();
+  bool topologyChanged = false;
+
+  if (m_routingTable)
+    {
+      m_routingTable->SetDeferUpdates (true);
+    }
+
+  for (; m_next < m_changes.size () && m_changes[m_next].at <= now; m_next++)
+    {
+      const Change &change = m_changes[m_next];
+      const LinkEnds &link = m_links[change.link];
+      switch (change.type)
+        {
+        case RATE:
+          link.device[0]->SetDataRate (DataRate (change.value));
+          link.device[1]->SetDataRate (DataRate (change.value));
+          break;
+        case DELAY:
+          m_delayAccessor->Set (PeekPointer (link.channel), TimeValue (NanoSeconds (change.value)));
+          break;
+        case DOWN:
+        case UP:
+          SetLinkUp (link, change.type == UP);
+          topologyChanged = true;
+          break;
+        }
+    }
+
+  if (m_routingTable)
+    {
+      m_routingTable->SetDeferUpdates (false);
+    }
+  if (topologyChanged && m_recomputeGlobalRouting)
+    {
+      Ipv4GlobalRoutingHelper::RecomputeRoutingTables ();
+    }
+
+  if (m_next < m_changes.size ())
+    {
+      m_event = Simulator::Schedule (NanoSeconds (m_changes[m_next].at - now), &LinkScheduleDriver::Apply, this);
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,100 @@
+#ifndef LINK_SCHEDULE_DRIVER_H
+#define LINK_SCHEDULE_DRIVER_H
+
+#include "ns3/attribute.h"
+#include "ns3/event-id.h"
+#include "ns3/net-device-container.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/ptr.h"
+
+#include "flat-routing-table.h"
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Replays a timeline of link rate, delay and up/down changes.
+ *
+ * Schedule files have one change per line, '#' starts a comment:
+ *
+ *   <time> <link> rate <rate>      e.g. 1.5s 4 rate 20Mbps
+ *   <time> <link> delay <delay>    e.g. 2s 4 delay 30ms
+ *   <time> <link> down
+ *   <time> <link> up
+ *
+ * <link> is the index of the link as added with AddLink, for links added
+ * with AddLinks from TopologyLoaderHelper::GetDevices the line order of the
+ * topology file.
+ *
+ * Start compiles all changes into one array sorted by time. A single event
+ * walks it and reschedules itself for the next change time, so the event
+ * queue holds one entry however long the timeline is. Changes of the same
+ * instant are applied together, with one routing update for all of them.
+ */
+class LinkScheduleDriver : public Object
+{
+public:
+  enum ChangeType : uint8_t {
+    RATE,
+    DELAY,
+    DOWN,
+    UP
+  };
+
+  static TypeId GetTypeId (void);
+  LinkScheduleDriver ();
+  virtual ~LinkScheduleDriver ();
+
+  uint32_t AddLink (Ptr<PointToPointNetDevice> a, Ptr<PointToPointNetDevice> b);
+  // Adds consecutive device pairs as links.
+  void AddLinks (const NetDeviceContainer &devices);
+  uint32_t GetNLinks (void) const { return m_links.size (); }
+
+  // value is the rate in bit/s for RATE and the delay in ns for DELAY.
+  void AddChange (Time at, uint32_t link, ChangeType type, uint64_t value = 0);
+  void Load (const std::string &filename);
+
+  // Shared table of Ipv4FlatRouting, updated once per instant.
+  void SetRoutingTable (Ptr<FlatRoutingTable> table) { m_routingTable = table; }
+
+  // Sorts the timeline and schedules the first change.
+  void Start (void);
+
+  uint64_t GetAppliedChanges (void) const { return m_next; }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  struct Change {
+    uint64_t at;      //!< Simulation time (ns)
+    uint64_t value;
+    uint32_t link;
+    ChangeType type;
+  };
+
+  struct LinkEnds {
+    Ptr<PointToPointNetDevice> device[2];
+    Ptr<PointToPointChannel> channel;
+  };
+
+  void Apply (void);
+  void SetLinkUp (const LinkEnds &link, bool up);
+
+  std::vector<LinkEnds> m_links;
+  std::vector<Change> m_changes;
+  size_t m_next;                             //!< First change not applied yet
+  EventId m_event;
+  Ptr<const AttributeAccessor> m_delayAccessor;
+  Ptr<FlatRoutingTable> m_routingTable;
+  bool m_recomputeGlobalRouting;
+};
+
+} // namespace ns3
+
+#endif /* LINK_SCHEDULE_DRIVER_H */
@@ -0,0 +1,178 @@
+#include "simulation-telemetry.h"
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/counting-scheduler.h"
+#include "ns3/global-value.h"
+#include "ns3/log.h"
+#include "ns3/object-factory.h"
+#include "ns3/resource-usage.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/tcp-speedtest-sender.h"
+#include "ns3/trace-sender-application.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SimulationTelemetry");
+
+NS_OBJECT_ENSURE_REGISTERED (SimulationTelemetry);
+
+TypeId
+SimulationTelemetry::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SimulationTelemetry")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<SimulationTelemetry> ()
+    .AddAttribute ("Interval",
+                   "Wall clock time between samples",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&SimulationTelemetry::m_interval),
+                   MakeTimeChecker (MilliSeconds (10)))
+    .AddAttribute ("File",
+                   "CSV file the samples are written to, none if empty",
+                   StringValue (""),
+                   MakeStringAccessor (&SimulationTelemetry::m_filename),
+                   MakeStringChecker ())
+    .AddAttribute ("Stderr",
+                   "Print every sample to stderr",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&SimulationTelemetry::m_stderr),
+                   MakeBooleanChecker ())
+  ;
+  return tid;
+}
+
+SimulationTelemetry::SimulationTelemetry ()
+  : m_stderr (true),
+    m_file (0),
+    m_step (MilliSeconds (1)),
+    m_lastSampleEvents (0),
+    m_checks (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SimulationTelemetry::~SimulationTelemetry ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SimulationTelemetry::DoDispose (void)
+{
+  Simulator::Cancel (m_event);
+  if (m_file)
+    {
+      fclose (m_file);
+      m_file = 0;
+    }
+  Object::DoDispose ();
+}
+
+void
+SimulationTelemetry::Start (void)
+{
+  if (!m_filename.empty () && !m_file)
+    {
+      m_file = fopen (m_filename.c_str (), "w");
+      NS_ABORT_MSG_IF (!m_file, "SimulationTelemetry: Unable to open " << m_filename);
+      fprintf (m_file, "wall_s,sim_s,speed,events,events_per_s,pending_events,rss_kib,peak_rss_kib,"
+                       "trace_records,probes_in_flight,speedtest_entries\n");
+    }
+
+  m_wallStart = std::chrono::steady_clock::now ();
+  m_lastCheckWall = m_wallStart;
+  m_lastSampleWall = m_wallStart;
+  m_lastCheckSim = Simulator::Now ();
+  m_lastSampleSim = m_lastCheckSim;
+  m_checks = 0;
+  m_lastSampleEvents = Simulator::GetEventCount ();
+
+  // Pending events are counted by a CountingScheduler around the configured
+  // one, the events move over unchanged.
+  if (!CountingScheduler::GetActive ())
+    {
+      TypeIdValue type;
+      GlobalValue::GetValueByName ("SchedulerType", type);
+      ObjectFactory factory;
+      factory.SetTypeId (CountingScheduler::GetTypeId ());
+      factory.Set ("Scheduler", type);
+      Simulator::SetScheduler (factory);
+    }
+
+  Simulator::Cancel (m_event);
+  m_event = Simulator::Schedule (m_step, &SimulationTelemetry::Check, this);
+}
+
+void
+SimulationTelemetry::Check (void)
+{
+  m_checks++;
+  auto now = std::chrono::steady_clock::now ();
+  double wall = std::chrono::duration<double> (now - m_lastCheckWall).count ();
+  double interval = m_interval.GetSeconds ();
+
+  // Aim for about four checks per interval at the current speed.
+  if (wall > 0)
+    {
+      double simPerWall = (Simulator::Now () - m_lastCheckSim).GetSeconds () / wall;
+      double step = std::min (std::max (simPerWall * interval / 4, 1e-6), 1.0);
+      m_step = Seconds (step);
+    }
+  m_lastCheckWall = now;
+  m_lastCheckSim = Simulator::Now ();
+
+  if (std::chrono::duration<double> (now - m_lastSampleWall).count () >= interval)
+    {
+      Sample ();
+    }
+  m_event = Simulator::Schedule (m_step, &SimulationTelemetry::Check, this);
+}
+
+void
+SimulationTelemetry::Sample (void)
+{
+  auto now = std::chrono::steady_clock::now ();
+  double wall = std::chrono::duration<double> (now - m_wallStart).count ();
+  double sinceLast = std::chrono::duration<double> (now - m_lastSampleWall).count ();
+  double sim = Simulator::Now ().GetSeconds ();
+  double speed = sinceLast > 0 ? (Simulator::Now () - m_lastSampleSim).GetSeconds () / sinceLast : 0;
+  // Checks of the telemetry itself are not simulation events.
+  uint64_t events = Simulator::GetEventCount () - m_checks;
+  double eventsPerSecond = sinceLast > 0 ? (events - m_lastSampleEvents) / sinceLast : 0;
+  CountingScheduler *scheduler = CountingScheduler::GetActive ();
+  uint64_t pending = scheduler ? scheduler->GetSize () : 0;
+  if (m_event.IsPending () && pending > 0)
+    {
+      pending--;
+    }
+  uint64_t rss = ResourceUsage::GetCurrentRssKiB ();
+  uint64_t peakRss = ResourceUsage::GetPeakRssKiB ();
+  uint64_t records, inFlight;
+  TraceFlowManager::GetInstance ().CountRecords (records, inFlight);
+  uint64_t entries = SpeedtestManager::GetInstance ().CountLiveEntries ();
+
+  if (m_file)
+    {
+      fprintf (m_file, "%.3f,%.6f,%.3f,%" PRIu64 ",%.0f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+               wall, sim, speed, events, eventsPerSecond, pending, rss, peakRss, records, inFlight, entries);
+      fflush (m_file);
+    }
+  if (m_stderr)
+    {
+      fprintf (stderr, "[telemetry] wall %.1fs sim %.3fs (%.2fx) %.0f events/s pending %" PRIu64 " RSS %" PRIu64
+                       " KiB (peak %" PRIu64 " KiB) records %" PRIu64 " in flight %" PRIu64 " speedtest %" PRIu64 "\n",
+               wall, sim, speed, eventsPerSecond, pending, rss, peakRss, records, inFlight, entries);
+    }
+
+  m_lastSampleWall = now;
+  m_lastSampleSim = Simulator::Now ();
+  m_lastSampleEvents = events;
+}
+
+} // namespace ns3
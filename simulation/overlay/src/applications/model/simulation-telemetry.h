@@ -0,0 +1,66 @@
+#ifndef SIMULATION_TELEMETRY_H
+#define SIMULATION_TELEMETRY_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace ns3 {
+
+/**
+ * Reports the progress of a running simulation about once per wall clock
+ * interval: simulated time, speed relative to real time, executed events
+ * per second, pending events, current and peak RSS, live trace records and
+ * in-flight probes, and live speed test entries.
+ *
+ * Samples go to stderr and, if File is set, to a CSV file. A single check
+ * event walks along the simulation, its step is adapted to the measured
+ * speed so that it runs a few times per interval. Counters are only read
+ * when a sample is taken, nothing is added to the packet path. Pending
+ * events come from a CountingScheduler that Start puts around the
+ * configured scheduler. The check events are left out of both event counts.
+ *
+ * The check event keeps the event queue non-empty, the simulation has to
+ * be ended with Simulator::Stop.
+ */
+class SimulationTelemetry : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  SimulationTelemetry ();
+  virtual ~SimulationTelemetry ();
+
+  // Schedules the first check, the wall clock starts here.
+  void Start (void);
+  // Takes a sample now, e.g. once Simulator::Run returned.
+  void Sample (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void Check (void);
+
+  Time m_interval;                //!< Wall clock time between samples
+  std::string m_filename;
+  bool m_stderr;
+
+  FILE *m_file;
+  EventId m_event;
+  Time m_step;                    //!< Simulated time between checks
+  std::chrono::steady_clock::time_point m_wallStart;
+  std::chrono::steady_clock::time_point m_lastCheckWall;
+  std::chrono::steady_clock::time_point m_lastSampleWall;
+  Time m_lastCheckSim;
+  Time m_lastSampleSim;
+  uint64_t m_lastSampleEvents;
+  uint64_t m_checks;              //!< Check events executed since Start
+};
+
+} // namespace ns3
+
+#endif /* SIMULATION_TELEMETRY_H */
@@ -0,0 +1,170 @@
+#include "speedtest-group.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <sstream>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SpeedtestGroup");
+
+NS_OBJECT_ENSURE_REGISTERED (SpeedtestGroup);
+
+TypeId
+SpeedtestGroup::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::SpeedtestGroup")
+    .SetParent<Object> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<SpeedtestGroup> ()
+    .AddAttribute ("BinWidth",
+                   "Simulated time covered by one row of goodput, delay and fairness",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&SpeedtestGroup::m_binWidth),
+                   MakeTimeChecker (MicroSeconds (1)))
+  ;
+  return tid;
+}
+
+SpeedtestGroup::SpeedtestGroup ()
+  : m_records (0),
+    m_bins (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+SpeedtestGroup::~SpeedtestGroup ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+SpeedtestGroup::DoDispose (void)
+{
+  Simulator::Cancel (m_binEvent);
+  if (m_records)
+    {
+      fclose (m_records);
+      m_records = 0;
+    }
+  if (m_bins)
+    {
+      fclose (m_bins);
+      m_bins = 0;
+    }
+  Object::DoDispose ();
+}
+
+uint32_t
+SpeedtestGroup::AddStream (void)
+{
+  NS_ABORT_MSG_IF (m_bins, "SpeedtestGroup: Streams have to be added before Start");
+  m_bytes.push_back (0);
+  m_delaySum.push_back (0);
+  m_delayMax.push_back (0);
+  m_delayCount.push_back (0);
+  return m_store.AddStream ();
+}
+
+void
+SpeedtestGroup::Start (uint32_t node)
+{
+  NS_LOG_FUNCTION (this << node);
+  if (m_bins)
+    {
+      return;
+    }
+
+  std::ostringstream records;
+  records << "speedtest_" << node << ".csv";
+  m_records = fopen (records.str ().c_str (), "w");
+  NS_ABORT_MSG_IF (!m_records, "SpeedtestGroup: Unable to open " << records.str ());
+  fprintf (m_records, "stream,send_time,receive_time,sock_rtt,sock_cwnd,progress\n");
+
+  std::ostringstream bins;
+  bins << "speedtest_bins_" << node << ".csv";
+  m_bins = fopen (bins.str ().c_str (), "w");
+  NS_ABORT_MSG_IF (!m_bins, "SpeedtestGroup: Unable to open " << bins.str ());
+  fprintf (m_bins, "time,stream,goodput_bps,delay_mean_ns,delay_max_ns,delay_samples,jain\n");
+
+  m_binStart = Simulator::Now ();
+  m_binEvent = Simulator::Schedule (m_binWidth, &SpeedtestGroup::CloseBin, this);
+}
+
+void
+SpeedtestGroup::AddDelay (uint32_t stream, uint64_t delayNs)
+{
+  m_delaySum[stream] += delayNs;
+  m_delayMax[stream] = std::max (m_delayMax[stream], delayNs);
+  m_delayCount[stream]++;
+}
+
+void
+SpeedtestGroup::CloseBin (void)
+{
+  WriteBin ();
+  m_binEvent = Simulator::Schedule (m_binWidth, &SpeedtestGroup::CloseBin, this);
+}
+
+void
+SpeedtestGroup::WriteBin (void)
+{
+  double seconds = (Simulator::Now () - m_binStart).GetSeconds ();
+  if (seconds <= 0)
+    {
+      return;
+    }
+  double time = m_binStart.GetSeconds ();
+
+  double sum = 0;
+  double sumSquares = 0;
+  uint64_t delaySum = 0;
+  uint64_t delayMax = 0;
+  uint64_t delayCount = 0;
+  for (uint32_t stream = 0; stream < m_bytes.size (); stream++)
+    {
+      double goodput = m_bytes[stream] * 8 / seconds;
+      sum += goodput;
+      sumSquares += goodput * goodput;
+      delaySum += m_delaySum[stream];
+      delayMax = std::max (delayMax, m_delayMax[stream]);
+      delayCount += m_delayCount[stream];
+      fprintf (m_bins, "%.6f,%" PRIu32 ",%.0f,%" PRIu64 ",%" PRIu64 ",%" PRIu32 ",\n", time, stream, goodput,
+               m_delayCount[stream] ? m_delaySum[stream] / m_delayCount[stream] : 0,
+               m_delayMax[stream], m_delayCount[stream]);
+    }
+
+  // Jain index (sum x)^2 / (n sum x^2): 1 if all streams got the same
+  // goodput, 1/n if one stream got everything. 0 for a bin without data.
+  double jain = sumSquares > 0 ? sum * sum / (m_bytes.size () * sumSquares) : 0;
+  fprintf (m_bins, "%.6f,all,%.0f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%.6f\n", time, sum,
+           delayCount ? delaySum / delayCount : 0, delayMax, delayCount, jain);
+
+  std::fill (m_bytes.begin (), m_bytes.end (), 0);
+  std::fill (m_delaySum.begin (), m_delaySum.end (), 0);
+  std::fill (m_delayMax.begin (), m_delayMax.end (), 0);
+  std::fill (m_delayCount.begin (), m_delayCount.end (), 0);
+  m_binStart = Simulator::Now ();
+}
+
+void
+SpeedtestGroup::WriteResults (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_bins)
+    {
+      return;
+    }
+  Simulator::Cancel (m_binEvent);
+  WriteBin ();
+  fclose (m_bins);
+  m_bins = 0;
+  fclose (m_records);
+  m_records = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,85 @@
+#ifndef SPEEDTEST_GROUP_H
+#define SPEEDTEST_GROUP_H
+
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+#include "speedtest-record-store.h"
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Shared bookkeeping of the parallel streams of one speed test, as the
+ * streams of an iperf -P run. Streams are numbered 0..n-1 by their join
+ * order. The chunk records of all streams live in one SpeedtestRecordStore
+ * keyed by stream, the bin counters in flat vectors indexed by stream.
+ *
+ * Goodput (bytes read by the receiver application) and delay samples are
+ * summed per stream in the current bin of BinWidth. When a bin closes, one
+ * row per stream and one aggregate row with the Jain fairness index of the
+ * stream goodputs are appended to speedtest_bins_<node>.csv. The chunk
+ * records of all streams go to the single file speedtest_<node>.csv, with
+ * a leading stream column.
+ *
+ * The first stream to start starts the group, so the first bin begins
+ * with the first data. The bin event keeps the event queue non-empty, the
+ * simulation has to be ended with Simulator::Stop.
+ */
+class SpeedtestGroup : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+  SpeedtestGroup ();
+  virtual ~SpeedtestGroup ();
+
+  // Adds a stream, returns its id.
+  uint32_t AddStream (void);
+  uint32_t GetNStreams (void) const { return m_bytes.size (); }
+
+  // Opens both files for the sender node and schedules the first bin end,
+  // only the first call does anything.
+  void Start (uint32_t node);
+  // Chunk records of all streams, keyed by stream id.
+  SpeedtestRecordStore &GetRecords (void) { return m_store; }
+  // Shared record file, null before Start.
+  FILE *GetRecordFile (void) const { return m_records; }
+
+  void AddBytes (uint32_t stream, uint64_t bytes) { m_bytes[stream] += bytes; }
+  void AddDelay (uint32_t stream, uint64_t delayNs);
+
+  // Closes the current, partial bin and both files. The streams have to
+  // have written their records before.
+  void WriteResults (void);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  void CloseBin (void);
+  // Writes the rows of the bin [m_binStart, now) and clears the counters.
+  void WriteBin (void);
+
+  Time m_binWidth;
+
+  FILE *m_records;
+  FILE *m_bins;
+  EventId m_binEvent;
+  Time m_binStart;
+
+  SpeedtestRecordStore m_store;
+
+  // Counters of the current bin, indexed by stream.
+  std::vector<uint64_t> m_bytes;
+  std::vector<uint64_t> m_delaySum;   //!< Nanoseconds
+  std::vector<uint64_t> m_delayMax;   //!< Nanoseconds
+  std::vector<uint32_t> m_delayCount;
+};
+
+} // namespace ns3
+
+#endif /* SPEEDTEST_GROUP_H */
@@ -0,0 +1,51 @@
+#include "speedtest-record-store.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+namespace ns3 {
+
+uint32_t
+SpeedtestRecordStore::AddStream() {
+  m_streams.emplace_back();
+  m_streams.back().firstSeq = 1;
+  m_streams.back().nextSeq = 1;
+  return m_streams.size() - 1;
+}
+
+SpeedtestRecord&
+SpeedtestRecordStore::Append(uint32_t stream) {
+  Stream &s = m_streams[stream];
+  NS_ABORT_MSG_IF(s.nextSeq == 0, "SpeedtestRecordStore: Chunk sequence space of stream " << stream << " exhausted!");
+  s.nextSeq++;
+  s.records.push_back(SpeedtestRecord{0, 0, 0, 0, 0});
+  return s.records.back();
+}
+
+void
+SpeedtestRecordStore::Write(FILE* file, uint32_t stream, uint32_t limit, bool streamColumn) {
+  Stream &s = m_streams[stream];
+  if (limit <= s.firstSeq) {
+    return;
+  }
+
+  size_t count = std::min<size_t>(limit - s.firstSeq, s.records.size());
+  for (size_t i = 0; i < count; i++) {
+    const SpeedtestRecord &record = s.records[i];
+    if (streamColumn) {
+      fprintf(file, "%" PRIu32 ",", stream);
+    }
+    fprintf(file, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 "\n",
+            record.sendTime,
+            record.receiveTime,
+            record.socketRTT,
+            record.cwnd,
+            record.progress);
+  }
+  s.records.erase(s.records.begin(), s.records.begin() + count);
+  s.firstSeq += count;
+}
+
+} // namespace ns3
@@ -0,0 +1,64 @@
+#ifndef SPEEDTEST_RECORD_STORE_H
+#define SPEEDTEST_RECORD_STORE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace ns3 {
+
+// Details of one sent chunk.
+struct SpeedtestRecord {
+  uint64_t sendTime;
+  uint64_t receiveTime;
+  uint64_t socketRTT;
+  int64_t progress;
+  int64_t cwnd;
+};
+
+/**
+ * Chunk records of one or more speed test streams, keyed by stream id.
+ *
+ * Chunks of every stream are numbered from 1 in send order. The records of
+ * a stream are kept in a dense deque, the record of chunk sequence s lives
+ * at index (s - first sequence). Written records are dropped from the
+ * front, so a stream only keeps the chunks that can still change.
+ */
+class SpeedtestRecordStore {
+public:
+  // Adds a stream, returns its id.
+  uint32_t AddStream();
+  uint32_t GetNStreams() const { return m_streams.size(); }
+
+  // Appends the record of the next chunk of stream, its sequence is
+  // NextSeq before the call.
+  SpeedtestRecord& Append(uint32_t stream);
+
+  SpeedtestRecord* Find(uint32_t stream, uint32_t seq) {
+    Stream &s = m_streams[stream];
+    uint64_t index = static_cast<uint64_t>(seq) - s.firstSeq;
+    return index < s.records.size() ? &s.records[index] : nullptr;
+  }
+
+  uint32_t FirstSeq(uint32_t stream) const { return m_streams[stream].firstSeq; }
+  uint32_t NextSeq(uint32_t stream) const { return m_streams[stream].nextSeq; }
+  size_t Size(uint32_t stream) const { return m_streams[stream].records.size(); }
+
+  // Writes the records of stream before sequence limit as CSV rows and
+  // drops them. Rows get a leading stream column if streamColumn is set.
+  void Write(FILE* file, uint32_t stream, uint32_t limit, bool streamColumn);
+
+private:
+  struct Stream {
+    std::deque<SpeedtestRecord> records;
+    uint32_t firstSeq;   //!< Sequence of records[0]
+    uint32_t nextSeq;    //!< Sequence of the next chunk
+  };
+
+  std::vector<Stream> m_streams;
+};
+
+} // namespace ns3
+
+#endif /* SPEEDTEST_RECORD_STORE_H */
@@ -55,6 +55,7 @@ void TCPSpeedtestReceiver::DoDispose(void) {
     NS_LOG_FUNCTION(this);
     m_socket = 0;
     m_socketList.clear();
+    m_streams.clear();
 
     // chain up
     Application::DoDispose();
@@ -104,6 +105,12 @@ void TCPSpeedtestReceiver::HandleAccept(Ptr<Socket> socket, const Address &from)
             MakeCallback(&TCPSpeedtestReceiver::HandlePeerError, this)
     );
     m_socketList.push_back(socket);
+
+    // Untagged senders are resolved once per connection.
+    TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().EndpointToSender(from);
+    if (sender && sender->GetTracking() == SpeedtestTracking::SEQUENCE) {
+        m_streams[PeekPointer(socket)] = SequenceStream{sender, 0};
+    }
 }
 
 void TCPSpeedtestReceiver::HandleRead(Ptr<Socket> socket) {
@@ -111,19 +118,32 @@ void TCPSpeedtestReceiver::HandleRead(Ptr<Socket> socket) {
 
     Ptr<Packet> packet;
     Address from;
+    auto stream = m_streams.find(PeekPointer(socket));
     while ((packet = socket->RecvFrom(from))) {
         if (packet->GetSize() == 0) { // EOFs
             break;
         }
         m_totalRx += packet->GetSize ();
 
+        if (stream != m_streams.end()) {
+            SequenceStream &sequence = stream->second;
+            if (!sequence.sender->m_trackAtDev) {
+                sequence.sender->AddStreamReception(sequence.offset);
+            }
+            sequence.sender->AddDeliveredBytes(packet->GetSize());
+            sequence.offset += packet->GetSize();
+            continue;
+        }
+
         TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().GetSender(packet);
         if (!sender) {
             SpeedtestManager::GetInstance().DebugPacket(packet);
             NS_FATAL_ERROR("Unmapped speedtest packet received!");
-        } else if (!sender->m_trackAtDev) {
+        }
+        if (!sender->m_trackAtDev) {
             sender->addReceptionDetails(packet, GetNode()->GetId());
         }
+        sender->AddDeliveredBytes(packet->GetSize());
     }
 }
 
@@ -146,6 +166,7 @@ void TCPSpeedtestReceiver::CleanUp(Ptr<Socket> socket) {
             break;
         }
     }
+    m_streams.erase(PeekPointer(socket));
 }
 
 } // Namespace ns3
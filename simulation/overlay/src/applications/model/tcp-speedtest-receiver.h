@@ -7,11 +7,14 @@
 #include "ns3/traced-callback.h"
 #include "ns3/address.h"
 
+#include <unordered_map>
+
 namespace ns3 {
 
 class Address;
 class Socket;
 class Packet;
+class TCPSpeedtestSender;
 
 class TCPSpeedtestReceiver : public Application
 {
@@ -40,6 +43,14 @@ private:
   Address m_local;        //!< Local address to bind to
   TypeId  m_tid;          //!< Protocol TypeId
   uint64_t m_totalRx;     //!< Total bytes received
+
+  // Accepted connections of senders with SEQUENCE tracking, reads are
+  // mapped to chunks by their offset in the stream instead of by tags.
+  struct SequenceStream {
+    TCPSpeedtestSender *sender;
+    uint64_t offset;      //!< Bytes read so far
+  };
+  std::unordered_map<Socket *, SequenceStream> m_streams;
 };
 
 } // namespace ns3
@@ -1,6 +1,9 @@
 #include "tcp-speedtest-sender.h"
 
 #include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/enum.h"
 #include "ns3/address.h"
 #include "ns3/node.h"
 #include "ns3/nstime.h"
@@ -14,9 +17,15 @@
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/tcp-socket-base.h"
 #include "ns3/tcp-tx-buffer.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-l4-protocol.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/inet-socket-address.h"
 
+#include <algorithm>
 #include <fstream>
 #include <cinttypes>
+#include <sstream>
 
 namespace ns3 {
 
@@ -38,7 +47,7 @@ void
 SpeedtestManager::DebugPacket(Ptr<const Packet> packet) {
   SpeedtestTag tag;
   if (packet->FindFirstMatchingByteTag(tag)) { 
-    if (packet_map.count(tag.GetId()) != 0) {
+    if (PacketToSender(tag.GetId()) != 0) {
       NS_LOG_INFO ("Packet " << packet->GetUid() << ": Has tag " << tag.GetId() << " and is mapped.");
     } else {
       NS_LOG_INFO ("Packet " << packet->GetUid() << ": Has tag " << tag.GetId() << " and is NOT mapped, size=" << packet->GetSize());
@@ -84,17 +93,30 @@ TCPSpeedtestSender::GetTypeId(void) {
             .AddAttribute("ReceiverID", "ID of the expected receiver node.",
                             UintegerValue(0),
                             MakeUintegerAccessor(&TCPSpeedtestSender::m_receiverId),
-                            MakeUintegerChecker<uint32_t>());
+                            MakeUintegerChecker<uint32_t>())
+            .AddAttribute("Tracking", "Map packets to chunk records by byte tags or by their offset in the TCP stream",
+                          EnumValue(SpeedtestTracking::TAG),
+                          MakeEnumAccessor<SpeedtestTracking>(&TCPSpeedtestSender::m_tracking),
+                          MakeEnumChecker(SpeedtestTracking::TAG, "Tag",
+                                          SpeedtestTracking::SEQUENCE, "Sequence"))
+            .AddAttribute("StreamResults",
+                          "Also write records of chunks the receiver did not read within FlushTimeout, and push "
+                          "every write to disk so the file can be followed during the run",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&TCPSpeedtestSender::m_stream),
+                          MakeBooleanChecker())
+            .AddAttribute("FlushInterval", "Interval between writes of records that can not change anymore",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&TCPSpeedtestSender::m_flushInterval),
+                          MakeTimeChecker(MilliSeconds(1)))
+            .AddAttribute("FlushTimeout", "Age after which a record is written even if the receiver did not see "
+                          "the chunk yet when streaming, a later receive time is lost",
+                          TimeValue(Seconds(10)),
+                          MakeTimeAccessor(&TCPSpeedtestSender::m_flushTimeout),
+                          MakeTimeChecker(Seconds(0)));
     return tid;
 }
 
-SpeedtestEntry::SpeedtestEntry ()
-  : sendTime (0),
-    receiveTime (0),
-    socketRTT (0),
-    progress (0),
-    cwnd (0) {}
-
 TCPSpeedtestSender::TCPSpeedtestSender()
         : m_socket(0),
           m_connected(false),
@@ -108,10 +130,18 @@ TCPSpeedtestSender::TCPSpeedtestSender()
           m_current_cwnd_byte(0),
           m_current_rtt_ns(0),
           m_cancel(false),
-          m_reusePacketId(0) {
+          m_reusePacketId(0),
+          m_store(0),
+          m_deliveredBytes(0),
+          m_tracking(SpeedtestTracking::TAG),
+          m_isn(0),
+          m_file(0),
+          m_streamId(0) {
     NS_LOG_FUNCTION(this);
 
     m_flowId = SpeedtestManager::GetInstance().RegisterSender(this);
+    m_store = &m_ownRecords;
+    m_streamId = m_store->AddStream();
 }
 
 TCPSpeedtestSender::~TCPSpeedtestSender() {
@@ -122,6 +152,21 @@ void
 TCPSpeedtestSender::DoDispose(void) {
     NS_LOG_FUNCTION(this);
 
+    m_flushEvent.Cancel();
+    if (m_group) {
+        // Null once the group closed the shared file.
+        m_file = m_group->GetRecordFile();
+        if (m_file) {
+            Flush(true);
+        }
+        m_file = 0;
+        m_group = 0;
+        m_store = &m_ownRecords;
+    } else if (m_file) {
+        Flush(true);
+        fclose(m_file);
+        m_file = 0;
+    }
     m_socket = 0;
     Application::DoDispose();
 }
@@ -152,6 +197,12 @@ void TCPSpeedtestSender::StartApplication(void) {
         m_socket->Connect(m_peer);
         m_socket->ShutdownRecv();
 
+        if (m_tracking == SpeedtestTracking::SEQUENCE) {
+            Address local;
+            m_socket->GetSockName(local);
+            SpeedtestManager::GetInstance().RegisterEndpoint(local, this);
+        }
+
         m_socket->SetConnectCallback(
                 MakeCallback(&TCPSpeedtestSender::ConnectionSucceeded, this),
                 MakeCallback(&TCPSpeedtestSender::ConnectionFailed, this)
@@ -165,6 +216,19 @@ void TCPSpeedtestSender::StartApplication(void) {
         m_socket->TraceConnectWithoutContext("CongestionWindow", MakeCallback(&TCPSpeedtestSender::CwndChange, this));
         m_socket->TraceConnectWithoutContext("RTT", MakeCallback(&TCPSpeedtestSender::RttChange, this));
     }
+
+    // Records of chunks the receiver read are written in every mode, so
+    // only chunks in flight are kept.
+    if (!m_file) {
+        if (m_group) {
+            // The first stream to start starts the bins of the group.
+            m_group->Start(GetNode()->GetId());
+            m_file = m_group->GetRecordFile();
+        } else {
+            OpenFile();
+        }
+        m_flushEvent = Simulator::Schedule(m_flushInterval, &TCPSpeedtestSender::FlushTick, this);
+    }
    
     if (m_connected) {
         if (m_noLimit) {
@@ -178,6 +242,7 @@ void TCPSpeedtestSender::StartApplication(void) {
 void TCPSpeedtestSender::StopApplication(void) {
     NS_LOG_FUNCTION(this);
     m_cancel = true;
+    m_flushEvent.Cancel();
     if (m_socket != nullptr) {
         m_socket->Close();
         m_connected = false;
@@ -201,23 +266,20 @@ void TCPSpeedtestSender::SendDataForcedNoLimit() {
         Ptr<Packet> packet;
         
         packet = Create<Packet>(m_packetSize);
-        uint64_t packetId = 0;
-        Ptr<SpeedtestEntry> entry;
-        if (m_reusePacketId == 0) {
-            packetId = SpeedtestManager::GetInstance().RegisterPacket(m_flowId);
-            entry = Create<SpeedtestEntry>();
-            m_trace_map[packetId] = entry;
-        } else {
-            packetId = m_reusePacketId;
-            m_reusePacketId = 0;
-            entry = m_trace_map[packetId];
+        uint64_t packetId = m_reusePacketId;
+        SpeedtestRecord *record = packetId ? FindRecord(packetId) : nullptr;
+        if (!record) {
+            record = &AppendRecord(packetId);
+        }
+        m_reusePacketId = 0;
+        if (m_tracking == SpeedtestTracking::TAG) {
+            SpeedtestTag tag(packetId);
+            packet->AddByteTag(tag);
         }
-        SpeedtestTag tag(packetId);
-        packet->AddByteTag(tag);
-        entry->sendTime = Simulator::Now().GetNanoSeconds();
-        entry->socketRTT = m_current_rtt_ns;
-        entry->cwnd = m_current_cwnd_byte;
-        entry->progress = GetAckedBytes();
+        record->sendTime = Simulator::Now().GetNanoSeconds();
+        record->socketRTT = m_current_rtt_ns;
+        record->cwnd = m_current_cwnd_byte;
+        record->progress = GetAckedBytes();
 
         int actual = m_socket->Send(packet);
 
@@ -245,16 +307,19 @@ void TCPSpeedtestSender::SendDataForced(bool force_packet_creation) {
 
     Ptr<Packet> packet;
     bool was_pending = false;
+    SpeedtestRecord details = {0, 0, 0, 0, 0};
     if (force_packet_creation) {
         packet = Create<Packet>(m_packetSize);
 
-        SpeedtestTag tag(SpeedtestManager::GetInstance().RegisterPacket(m_flowId));
-        packet->AddByteTag(tag);
-        Ptr<SpeedtestEntry> entry = Create<SpeedtestEntry>();
-        entry->socketRTT = m_current_rtt_ns;
-        entry->cwnd = m_current_cwnd_byte;
-        entry->progress = GetAckedBytes();
-        m_trace_map[tag.GetId()] = entry;
+        if (m_tracking == SpeedtestTracking::TAG) {
+            uint64_t packetId;
+            SpeedtestRecord &record = AppendRecord(packetId);
+            record.socketRTT = m_current_rtt_ns;
+            record.cwnd = m_current_cwnd_byte;
+            record.progress = GetAckedBytes();
+            SpeedtestTag tag(packetId);
+            packet->AddByteTag(tag);
+        }
     } else {
         if (m_pending.empty()) {
             NS_ABORT_MSG("Packet should be in Queue, but isnt.");
@@ -266,8 +331,20 @@ void TCPSpeedtestSender::SendDataForced(bool force_packet_creation) {
         m_pending.pop_front();
     }
 
+    // Untagged chunks get their record once they are in the stream, so
+    // records stay in stream order when a pending chunk is sent late.
+    if (m_tracking == SpeedtestTracking::SEQUENCE) {
+        details.socketRTT = m_current_rtt_ns;
+        details.cwnd = m_current_cwnd_byte;
+        details.progress = GetAckedBytes();
+    }
+
     int actual = m_socket->Send(packet);
     if (actual != -1) {
+        if (m_tracking == SpeedtestTracking::SEQUENCE) {
+            uint64_t packetId;
+            AppendRecord(packetId) = details;
+        }
         m_txTrace(packet);
         m_totBytes += actual;
     }
@@ -296,6 +373,8 @@ void TCPSpeedtestSender::ConnectionSucceeded(Ptr <Socket> socket) {
     NS_LOG_FUNCTION(this << socket);
     NS_LOG_LOGIC("TCPSpeedtestSender Connection succeeded");
     m_connected = true;
+    // Nothing was sent yet, the buffer starts right after the SYN.
+    m_isn = m_socket->GetObject<TcpSocketBase>()->GetTxBuffer()->HeadSequence().GetValue() - 1;
     if (m_noLimit) {
         SendDataForcedNoLimit();
     } else {
@@ -411,8 +490,9 @@ void TCPSpeedtestSender::addReceptionDetails(Ptr<const Packet> packet, uint32_t
 
     SpeedtestTag tag;
     if (!packet->FindFirstMatchingByteTag(tag)) return;
-    Ptr<SpeedtestEntry> element = m_trace_map.at(tag.GetId());
-    element->receiveTime = Simulator::Now().GetNanoSeconds();
+    if (SpeedtestRecord *record = FindRecord(tag.GetId())) {
+        SetReceived(*record);
+    }
 }
 
 void TCPSpeedtestSender::addTransmissionDetails(Ptr<const Packet> packet, uint32_t at_node) {
@@ -420,33 +500,188 @@ void TCPSpeedtestSender::addTransmissionDetails(Ptr<const Packet> packet, uint32
 
     SpeedtestTag tag;
     if (!packet->FindFirstMatchingByteTag(tag)) return;
-    Ptr<SpeedtestEntry> element = m_trace_map.at(tag.GetId());
-    element->sendTime = Simulator::Now().GetNanoSeconds();
+    if (SpeedtestRecord *record = FindRecord(tag.GetId())) {
+        record->sendTime = Simulator::Now().GetNanoSeconds();
+    }
 }
 
-void TCPSpeedtestSender::WriteResults() {
+void TCPSpeedtestSender::AddStreamReception(uint64_t offset) {
+    if (SpeedtestRecord *record = FindStreamOffset(offset)) {
+        SetReceived(*record);
+    }
+}
+
+uint64_t TCPSpeedtestSender::SegmentOffset(const TcpHeader &header) const {
+    uint32_t relative = header.GetSequenceNumber().GetValue() - m_isn - 1;
+    uint64_t offset = (m_totBytes & ~0xFFFFFFFFULL) | relative;
+    if (offset > m_totBytes + (1ULL << 31) && offset >= (1ULL << 32)) {
+        offset -= 1ULL << 32;
+    } else if (offset + (1ULL << 31) < m_totBytes) {
+        offset += 1ULL << 32;
+    }
+    return offset;
+}
+
+void TCPSpeedtestSender::AddSegmentTransmission(const TcpHeader &header) {
+    if (SpeedtestRecord *record = FindStreamOffset(SegmentOffset(header))) {
+        record->sendTime = Simulator::Now().GetNanoSeconds();
+    }
+}
+
+void TCPSpeedtestSender::AddSegmentReception(const TcpHeader &header) {
+    if (SpeedtestRecord *record = FindStreamOffset(SegmentOffset(header))) {
+        SetReceived(*record);
+    }
+}
+
+void TCPSpeedtestSender::SetReceived(SpeedtestRecord &record) {
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    // Chunks without a send time, e.g. rate limited ones tracked at the
+    // socket, give no delay sample.
+    if (m_group && record.receiveTime == 0 && record.sendTime != 0) {
+        m_group->AddDelay(m_streamId, now - record.sendTime);
+    }
+    record.receiveTime = now;
+}
+
+void TCPSpeedtestSender::SetGroup(Ptr<SpeedtestGroup> group) {
+    NS_ABORT_MSG_IF(m_socket, "TCPSpeedtestSender: Flow " << m_flowId << " joined a group after its start");
+    m_group = group;
+    m_store = &group->GetRecords();
+    m_streamId = group->AddStream();
+}
+
+SpeedtestRecord &TCPSpeedtestSender::AppendRecord(uint64_t &packetId) {
+    packetId = SpeedtestManager::MakePacketId(m_flowId, m_store->NextSeq(m_streamId));
+    return m_store->Append(m_streamId);
+}
+
+SpeedtestRecord *TCPSpeedtestSender::FindRecord(uint64_t packetId) {
+    return FindSeq(SpeedtestManager::PacketIdToSeq(packetId));
+}
+
+uint64_t TCPSpeedtestSender::AddEntry(uint64_t sendTime, uint64_t receiveTime, uint64_t socketRtt, int64_t cwnd, int64_t progress) {
+    uint64_t packetId;
+    SpeedtestRecord &record = AppendRecord(packetId);
+    record.sendTime = sendTime;
+    record.receiveTime = receiveTime;
+    record.socketRTT = socketRtt;
+    record.cwnd = cwnd;
+    record.progress = progress;
+    return packetId;
+}
+
+std::string TCPSpeedtestSender::GetFileName() const {
     std::ostringstream oss;
     oss << "speedtest_" << m_node->GetId() << ".csv";
-    std::string filename = oss.str();
+    return oss.str();
+}
 
+void TCPSpeedtestSender::OpenFile() {
+    std::string filename = GetFileName();
     NS_LOG_INFO ("Writing speedtest file to " << filename << " ... ");
-    FILE *test_csv = fopen(filename.c_str(), "w+");
-
-    fprintf(test_csv, "send_time,receive_time,sock_rtt,sock_cwnd,progress\n");
-
-    for (const auto& map_entry : m_trace_map) {
-        const auto& entry = map_entry.second;
-        fprintf(test_csv, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRId64 ",%" PRId64 "\n",
-            entry->sendTime,
-            entry->receiveTime,
-            entry->socketRTT,
-            entry->cwnd,
-            entry->progress
-        );
+    m_file = fopen(filename.c_str(), "w+");
+    NS_ABORT_MSG_IF(!m_file, "TCPSpeedtestSender: Unable to open " << filename);
+    fprintf(m_file, "send_time,receive_time,sock_rtt,sock_cwnd,progress\n");
+}
+
+void TCPSpeedtestSender::Flush(bool force) {
+    uint32_t nextSeq = m_store->NextSeq(m_streamId);
+    uint32_t limit = nextSeq;
+    if (!force) {
+        // TCP delivers in order, chunks the receiver read completely can
+        // not change anymore.
+        limit = static_cast<uint32_t>(std::min<uint64_t>(1 + m_deliveredBytes / m_packetSize, nextSeq));
+
+        // When streaming, chunks created before a mark older than the
+        // timeout are written whether they arrived or not.
+        if (m_stream) {
+            uint64_t now = Simulator::Now().GetNanoSeconds();
+            uint64_t timeout = m_flushTimeout.GetNanoSeconds();
+            while (!m_flushMarks.empty() && now - m_flushMarks.front().first >= timeout) {
+                limit = std::max(limit, m_flushMarks.front().second);
+                m_flushMarks.pop_front();
+            }
+            m_flushMarks.push_back(std::make_pair(now, nextSeq));
+        }
+
+        // A chunk the socket refused is sent again with the same record.
+        if (m_reusePacketId) {
+            limit = std::min(limit, SpeedtestManager::PacketIdToSeq(m_reusePacketId));
+        }
     }
+    if (limit <= m_store->FirstSeq(m_streamId)) {
+        return;
+    }
+
+    m_store->Write(m_file, m_streamId, limit, m_group != 0);
+    if (m_stream || force) {
+        fflush(m_file);
+    }
+}
 
-    fclose(test_csv);
-    NS_LOG_INFO ("Closed speedtest file " << filename);
+void TCPSpeedtestSender::FlushTick() {
+    Flush(false);
+    m_flushEvent = Simulator::Schedule(m_flushInterval, &TCPSpeedtestSender::FlushTick, this);
+}
+
+void TCPSpeedtestSender::WriteResults() {
+    if (m_group) {
+        // The group closes the shared file once all streams wrote.
+        m_flushEvent.Cancel();
+        m_file = m_group->GetRecordFile();
+        if (!m_file && m_store->Size(m_streamId) == 0) {
+            // No stream of the group started.
+            return;
+        }
+        NS_ABORT_MSG_IF(!m_file, "TCPSpeedtestSender: Record file of the group of flow " << m_flowId << " is closed");
+        Flush(true);
+        m_file = 0;
+        return;
+    }
+
+    // Records were written during the run, only the remaining ones are left.
+    m_flushEvent.Cancel();
+    if (!m_file) {
+        OpenFile();
+    }
+    Flush(true);
+
+    fclose(m_file);
+    m_file = 0;
+    NS_LOG_INFO ("Closed speedtest file " << GetFileName());
+}
+
+static uint64_t SegmentKey(Ipv4Address address, uint16_t port) {
+    return (static_cast<uint64_t>(address.Get()) << 16) | port;
+}
+
+void SpeedtestManager::RegisterEndpoint(const Address &local, TCPSpeedtestSender *sender) {
+    endpoints.push_back(std::make_pair(local, sender));
+    if (sender->m_trackAtDev && InetSocketAddress::IsMatchingType(local)) {
+        InetSocketAddress address = InetSocketAddress::ConvertFrom(local);
+        segment_senders[SegmentKey(address.GetIpv4(), address.GetPort())] = sender;
+    }
+}
+
+void SpeedtestManager::TrackSegment(Ptr<const Packet> packet, uint32_t nodeId, bool transmit) {
+    Ptr<Packet> segment = packet->Copy();
+    Ipv4Header ip;
+    segment->RemoveHeader(ip);
+    if (ip.GetProtocol() != TcpL4Protocol::PROT_NUMBER) return;
+    TcpHeader tcp;
+    segment->RemoveHeader(tcp);
+    // Handshake and pure ACKs carry no chunk.
+    if (segment->GetSize() == 0) return;
+
+    auto it = segment_senders.find(SegmentKey(ip.GetSource(), tcp.GetSourcePort()));
+    if (it == segment_senders.end()) return;
+    TCPSpeedtestSender *sender = it->second;
+    if (transmit && sender->GetNode()->GetId() == nodeId) {
+        sender->AddSegmentTransmission(tcp);
+    } else if (!transmit && sender->m_receiverId == nodeId) {
+        sender->AddSegmentReception(tcp);
+    }
 }
 
 bool SpeedtestManager::isPacketFrom(Ptr<Packet> pkt, uint64_t nodeId) {
@@ -8,26 +8,22 @@
 #include "ns3/string.h"
 #include "ns3/traced-callback.h"
 #include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "trace-context.h"
+#include "speedtest-group.h"
+#include "speedtest-record-store.h"
 
-#include <map>
-#include <queue>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ns3 {
 
 class Address;
 class Socket;
 
-class SpeedtestEntry : public Object {
-  public:
-    uint64_t sendTime;
-    uint64_t receiveTime;
-    uint64_t socketRTT;
-    int64_t progress;
-    int64_t cwnd;
-
-    SpeedtestEntry();
-};
-
 class SpeedtestTag : public ns3::Tag {
 public:
   SpeedtestTag() : m_id(0) {}
@@ -64,6 +60,18 @@ private:
   uint64_t m_id;
 };
 
+/**
+ * TAG marks every chunk with a SpeedtestTag that devices and the receiver
+ * look up. SEQUENCE sends untagged chunks, receptions are mapped back to
+ * chunks by their byte offset in the TCP stream.
+ */
+enum class SpeedtestTracking {
+  TAG,
+  SEQUENCE
+};
+
+class TcpHeader;
+
 class TCPSpeedtestSender : public Application
 {
 public:
@@ -85,6 +93,35 @@ public:
   void addReceptionDetails(Ptr<const Packet> packet, uint32_t at_node);
   void addTransmissionDetails(Ptr<const Packet> packet, uint32_t at_node);
 
+  SpeedtestTracking GetTracking() const { return m_tracking; }
+  // SEQUENCE tracking: the receiver application read the stream byte at
+  // offset as the first byte of a read.
+  void AddStreamReception(uint64_t offset);
+  // SEQUENCE tracking at device level, called from the same device hooks
+  // as addTransmissionDetails and addReceptionDetails with a data segment
+  // of this flow.
+  void AddSegmentTransmission(const TcpHeader &header);
+  void AddSegmentReception(const TcpHeader &header);
+
+  // Tracks a packet that was not sent by this application, used by
+  // benchmarks to fill the record store. Returns its packet id.
+  uint64_t AddEntry(uint64_t sendTime, uint64_t receiveTime, uint64_t socketRtt, int64_t cwnd, int64_t progress);
+  // Records of the transfer not written yet.
+  size_t GetLiveEntries() const { return m_store->Size(m_streamId); }
+
+  // Makes this sender a stream of a parallel speed test, before it starts.
+  // Its records then live in the store of the group and are written to
+  // the shared file of the group.
+  void SetGroup(Ptr<SpeedtestGroup> group);
+  Ptr<SpeedtestGroup> GetGroup() const { return m_group; }
+  // The receiver application read bytes of this stream.
+  void AddDeliveredBytes(uint32_t bytes) {
+    m_deliveredBytes += bytes;
+    if (m_group) {
+      m_group->AddBytes(m_streamId, bytes);
+    }
+  }
+
   uint64_t        m_receiverId;
   bool            m_trackAtDev;
 
@@ -94,7 +131,29 @@ private:
   virtual void StartApplication (void);    // Called at time specified by Start
   virtual void StopApplication (void);     // Called at time specified by Stop
 
-  std::map<uint64_t, Ptr<SpeedtestEntry>> m_trace_map{};
+  // Appends the record of the next chunk, its packet id goes to packetId.
+  SpeedtestRecord &AppendRecord(uint64_t &packetId);
+  // Record of a packet id of this flow, null once it was written.
+  SpeedtestRecord *FindRecord(uint64_t packetId);
+  SpeedtestRecord *FindSeq(uint32_t seq) {
+    return m_store->Find(m_streamId, seq);
+  }
+  // All chunks have PacketSize bytes and enter the stream in sequence
+  // order, so the chunk of a stream offset follows by division.
+  SpeedtestRecord *FindStreamOffset(uint64_t offset) {
+    return FindSeq(1 + offset / m_packetSize);
+  }
+  // Sets the receive time, the first one also gives a delay sample to the group.
+  void SetReceived(SpeedtestRecord &record);
+  // Stream offset of the first byte of a segment, the 32 bit TCP sequence
+  // number is unwrapped next to the bytes accepted so far.
+  uint64_t SegmentOffset(const TcpHeader &header) const;
+
+  std::string GetFileName() const;
+  void OpenFile();
+  // Writes the records that can not change anymore, all if force is set.
+  void Flush(bool force);
+  void FlushTick();
 
   /**
    * Send data until the L4 transmission buffer is full.
@@ -119,12 +178,26 @@ private:
   uint32_t        m_current_cwnd_byte;     //!< Current congestion window (detailed logging)
   int64_t         m_current_rtt_ns;        //!< Current last RTT sample (detailed logging)
   Time            m_lastSendTime;     //!< Last send timestamp
-  uint64_t        m_flowId;
+  uint32_t        m_flowId;
   bool            m_noLimit;
   bool            m_cancel;
   uint64_t        m_reusePacketId;
   std::deque<Ptr<Packet>>     m_pending;
 
+  SpeedtestRecordStore m_ownRecords;
+  SpeedtestRecordStore *m_store;  //!< m_ownRecords, or the store of m_group
+  uint64_t        m_deliveredBytes; //!< Bytes read by the receiver application
+  SpeedtestTracking m_tracking;
+  uint32_t        m_isn;          //!< Initial TCP sequence number, known once connected
+  bool            m_stream;
+  Time            m_flushInterval;
+  Time            m_flushTimeout;
+  EventId         m_flushEvent;
+  std::deque<std::pair<uint64_t, uint32_t>> m_flushMarks;  //!< (time, next sequence) of past flushes
+  FILE           *m_file;         //!< Shared with the other streams of m_group
+  Ptr<SpeedtestGroup> m_group;
+  uint32_t        m_streamId;     //!< Stream of m_store
+
   // TCP flow logging
   TracedCallback<Ptr<const Packet> > m_txTrace;
 
@@ -147,46 +220,88 @@ class SpeedtestManager {
     return instance;
   }
 
-  uint16_t RegisterSender(TCPSpeedtestSender *sender) {
-    uint16_t id = flow_counter++;
-    flow_map[id] = sender;
-    return id;
+  // Packet ids carry their flow in the upper bits and the chunk sequence of
+  // the flow in the lower bits, as the probe ids of TraceFlowManager.
+  static const uint32_t PACKET_SEQ_BITS = 32;
+
+  static uint64_t MakePacketId(uint32_t flow, uint32_t seq) {
+    return (static_cast<uint64_t>(flow) << PACKET_SEQ_BITS) | seq;
+  }
+
+  static uint32_t PacketIdToFlow(uint64_t packet_id) {
+    return static_cast<uint32_t>(packet_id >> PACKET_SEQ_BITS);
   }
 
-  uint64_t RegisterPacket(uint16_t src) {
-    uint64_t packet = packet_counter++;
-    packet_map[packet] = src;
-    return packet;
+  static uint32_t PacketIdToSeq(uint64_t packet_id) {
+    return static_cast<uint32_t>(packet_id);
+  }
+
+  uint32_t RegisterSender(TCPSpeedtestSender *sender) {
+    TraceContext::Attach();
+    flow_table.push_back(sender);
+    return flow_table.size() - 1;
   }
 
   TCPSpeedtestSender *PacketToSender(uint64_t packet_id) {
-    if (packet_map.count(packet_id) == 0) {
-      return 0;
-    }
+    uint32_t flow = PacketIdToFlow(packet_id);
+    return flow < flow_table.size() ? flow_table[flow] : 0;
+  }
 
-    uint16_t handler = packet_map.at(packet_id);
+  // Untagged (SEQUENCE) senders are found by their socket address, once
+  // per accepted connection.
+  void RegisterEndpoint(const Address &local, TCPSpeedtestSender *sender);
 
-    if (flow_map.count(handler) == 0) {
-      return 0;
+  TCPSpeedtestSender *EndpointToSender(const Address &peer) const {
+    for (const auto &endpoint : endpoints) {
+      if (endpoint.first == peer) {
+        return endpoint.second;
+      }
     }
+    return 0;
+  }
 
-    return flow_map.at(handler);
+  uint64_t CountLiveEntries() const {
+    uint64_t entries = 0;
+    for (const TCPSpeedtestSender *sender : flow_table) {
+      if (sender) {
+        entries += sender->GetLiveEntries();
+      }
+    }
+    return entries;
   }
 
+  // Whether a SEQUENCE sender tracks at device level, devices only look at
+  // TCP headers then.
+  bool TracksSegments() const { return !segment_senders.empty(); }
+  // Passes a data segment of a SEQUENCE sender tracking at device level
+  // to it, at its own node on transmission and at the receiver node on
+  // reception. The packet starts with the IPv4 header.
+  void TrackSegment(Ptr<const Packet> packet, uint32_t nodeId, bool transmit);
+
   bool isPacketFrom(Ptr<Packet> pkt, uint64_t nodeId);
   bool isPacketTo(Ptr<Packet> pkt, uint64_t nodeId);
 
   TCPSpeedtestSender *GetSender(Ptr<const Packet> packet);
   void DebugPacket(Ptr<const Packet> packet);
+
+  // Forgets all senders, see TraceContext.
+  void Reset() {
+    flow_table.assign(1, nullptr);
+    endpoints.clear();
+    segment_senders.clear();
+  }
 private:
-  SpeedtestManager() {}
+  SpeedtestManager() : flow_table(1, nullptr) {}
   SpeedtestManager(const SpeedtestManager&) = delete;
   SpeedtestManager& operator=(const SpeedtestManager) = delete;
 
-  uint16_t flow_counter = 1;
-  uint64_t packet_counter = 1;
-  std::map<uint16_t, TCPSpeedtestSender *> flow_map{};
-  std::map<uint64_t, uint16_t> packet_map{};
+  // Dense flow table indexed by flow id, slot 0 is reserved so that no
+  // packet id is 0.
+  std::vector<TCPSpeedtestSender *> flow_table;
+  std::vector<std::pair<Address, TCPSpeedtestSender *>> endpoints;
+  // Senders tracking segments at device level, keyed by IPv4 address and
+  // port of their socket.
+  std::unordered_map<uint64_t, TCPSpeedtestSender *> segment_senders;
 };
 
 } // namespace ns3
@@ -0,0 +1,325 @@
+#include "timing-wheel-scheduler.h"
+
+#include "ns3/abort.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TimingWheelScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TimingWheelScheduler);
+
+static bool
+EventBefore (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key < b.key;
+}
+
+TypeId
+TimingWheelScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TimingWheelScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Applications")
+    .AddConstructor<TimingWheelScheduler> ()
+    .AddAttribute ("Slots",
+                   "Buckets of the wheel, a power of two",
+                   UintegerValue (8192),
+                   MakeUintegerAccessor (&TimingWheelScheduler::SetSlots,
+                                         &TimingWheelScheduler::GetSlots),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("SlotWidth",
+                   "Time covered by one bucket, rounded down to a power of two time steps",
+                   TimeValue (MicroSeconds (8)),
+                   MakeTimeAccessor (&TimingWheelScheduler::SetSlotWidth,
+                                     &TimingWheelScheduler::GetSlotWidth),
+                   MakeTimeChecker (TimeStep (1)))
+  ;
+  return tid;
+}
+
+TimingWheelScheduler::TimingWheelScheduler ()
+  : m_slots (8192),
+    m_slotWidth (MicroSeconds (8)),
+    m_shift (0),
+    m_mask (0),
+    m_base (0),
+    m_nextSlot (0),
+    m_wheelCount (0),
+    m_now (0)
+{
+  NS_LOG_FUNCTION (this);
+  Resize ();
+}
+
+TimingWheelScheduler::~TimingWheelScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TimingWheelScheduler::SetSlots (uint32_t slots)
+{
+  NS_ABORT_MSG_IF (slots == 0 || (slots & (slots - 1)) != 0,
+                   "TimingWheelScheduler: Slots must be a power of two, got " << slots);
+  m_slots = slots;
+  Resize ();
+}
+
+void
+TimingWheelScheduler::SetSlotWidth (Time width)
+{
+  m_slotWidth = width;
+  Resize ();
+}
+
+void
+TimingWheelScheduler::Resize (void)
+{
+  NS_LOG_FUNCTION (this << m_slots << m_slotWidth);
+  NS_ABORT_MSG_IF (!IsEmpty (), "TimingWheelScheduler: Can not resize a wheel that holds events");
+
+  uint64_t steps = std::max<int64_t> (m_slotWidth.GetTimeStep (), 1);
+  m_shift = 0;
+  while ((2ULL << m_shift) <= steps)
+    {
+      m_shift++;
+    }
+  m_mask = m_slots - 1;
+  m_buckets.assign (m_slots, Bucket{{}, 0, true});
+  m_base = SlotOf (m_now);
+  m_nextSlot = m_base;
+}
+
+void
+TimingWheelScheduler::Insert (const Event &ev)
+{
+  NS_ASSERT (ev.key.m_ts >= m_now);
+
+  // Events of the current time run after everything already scheduled for
+  // it, their uids only grow. A slower insert keeps the order otherwise.
+  if (ev.key.m_ts == m_now)
+    {
+      if (m_fastLane.empty () || EventBefore (m_fastLane.back (), ev))
+        {
+          m_fastLane.push_back (ev);
+        }
+      else
+        {
+          m_fastLane.insert (std::upper_bound (m_fastLane.begin (), m_fastLane.end (), ev, EventBefore), ev);
+        }
+      return;
+    }
+
+  uint64_t slot = SlotOf (ev.key.m_ts);
+  if (slot < m_base + m_slots)
+    {
+      InsertWheel (ev, slot);
+    }
+  else
+    {
+      m_overflow.insert (std::make_pair (ev.key, ev.impl));
+    }
+}
+
+void
+TimingWheelScheduler::InsertWheel (const Event &ev, uint64_t slot)
+{
+  Bucket &bucket = BucketOf (slot);
+  if (m_wheelCount == 0 || slot < m_nextSlot)
+    {
+      // All buckets before the next one are empty.
+      bucket.events.push_back (ev);
+      bucket.sorted = true;
+      m_nextSlot = slot;
+    }
+  else if (slot == m_nextSlot)
+    {
+      bucket.events.insert (std::upper_bound (bucket.events.begin () + bucket.head, bucket.events.end (), ev, EventBefore), ev);
+    }
+  else
+    {
+      bucket.events.push_back (ev);
+      bucket.sorted = false;
+    }
+  m_wheelCount++;
+}
+
+bool
+TimingWheelScheduler::IsEmpty (void) const
+{
+  return m_fastLane.empty () && m_wheelCount == 0 && m_overflow.empty ();
+}
+
+TimingWheelScheduler::Tier
+TimingWheelScheduler::NextTier (void) const
+{
+  // Overflow events are beyond the horizon of the wheel, fast lane events
+  // are at the current time, only wheel events can come before them.
+  if (m_wheelCount > 0)
+    {
+      const Bucket &bucket = BucketOf (m_nextSlot);
+      if (m_fastLane.empty () || EventBefore (bucket.events[bucket.head], m_fastLane.front ()))
+        {
+          return WHEEL;
+        }
+      return FAST_LANE;
+    }
+  return m_fastLane.empty () ? OVERFLOW : FAST_LANE;
+}
+
+Scheduler::Event
+TimingWheelScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  switch (NextTier ())
+    {
+    case FAST_LANE:
+      return m_fastLane.front ();
+    case WHEEL:
+      {
+        const Bucket &bucket = BucketOf (m_nextSlot);
+        return bucket.events[bucket.head];
+      }
+    default:
+      {
+        Event ev;
+        ev.key = m_overflow.begin ()->first;
+        ev.impl = m_overflow.begin ()->second;
+        return ev;
+      }
+    }
+}
+
+Scheduler::Event
+TimingWheelScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  Event ev;
+  switch (NextTier ())
+    {
+    case FAST_LANE:
+      ev = m_fastLane.front ();
+      m_fastLane.pop_front ();
+      break;
+    case WHEEL:
+      {
+        uint64_t slot = m_nextSlot;
+        Bucket &bucket = BucketOf (slot);
+        ev = bucket.events[bucket.head++];
+        m_wheelCount--;
+        if (bucket.head == bucket.events.size ())
+          {
+            bucket.events.clear ();
+            bucket.head = 0;
+            bucket.sorted = true;
+            if (m_wheelCount > 0)
+              {
+                m_nextSlot = slot + 1;
+                FindNextSlot ();
+              }
+          }
+        m_now = ev.key.m_ts;
+        Advance (slot);
+        break;
+      }
+    default:
+      {
+        auto it = m_overflow.begin ();
+        ev.key = it->first;
+        ev.impl = it->second;
+        m_overflow.erase (it);
+        m_now = ev.key.m_ts;
+        Advance (SlotOf (m_now));
+        break;
+      }
+    }
+  return ev;
+}
+
+void
+TimingWheelScheduler::Remove (const Event &ev)
+{
+  if (ev.key.m_ts == m_now)
+    {
+      for (auto it = m_fastLane.begin (); it != m_fastLane.end (); ++it)
+        {
+          if (it->key.m_uid == ev.key.m_uid)
+            {
+              m_fastLane.erase (it);
+              return;
+            }
+        }
+    }
+
+  uint64_t slot = SlotOf (ev.key.m_ts);
+  if (m_wheelCount > 0 && slot < m_base + m_slots)
+    {
+      Bucket &bucket = BucketOf (slot);
+      for (size_t i = bucket.head; i < bucket.events.size (); i++)
+        {
+          if (bucket.events[i].key.m_uid != ev.key.m_uid)
+            {
+              continue;
+            }
+          bucket.events.erase (bucket.events.begin () + i);
+          m_wheelCount--;
+          if (bucket.head == bucket.events.size ())
+            {
+              bucket.events.clear ();
+              bucket.head = 0;
+              bucket.sorted = true;
+              if (slot == m_nextSlot && m_wheelCount > 0)
+                {
+                  m_nextSlot = slot + 1;
+                  FindNextSlot ();
+                }
+            }
+          return;
+        }
+    }
+
+  auto it = m_overflow.find (ev.key);
+  NS_ASSERT_MSG (it != m_overflow.end (), "TimingWheelScheduler: Removed event is not scheduled");
+  m_overflow.erase (it);
+}
+
+void
+TimingWheelScheduler::Advance (uint64_t slot)
+{
+  if (slot <= m_base)
+    {
+      return;
+    }
+  m_base = slot;
+  while (!m_overflow.empty () && SlotOf (m_overflow.begin ()->first.m_ts) < m_base + m_slots)
+    {
+      Event ev;
+      ev.key = m_overflow.begin ()->first;
+      ev.impl = m_overflow.begin ()->second;
+      m_overflow.erase (m_overflow.begin ());
+      InsertWheel (ev, SlotOf (ev.key.m_ts));
+    }
+}
+
+void
+TimingWheelScheduler::FindNextSlot (void)
+{
+  NS_ASSERT (m_wheelCount > 0);
+  while (BucketOf (m_nextSlot).head == BucketOf (m_nextSlot).events.size ())
+    {
+      m_nextSlot++;
+    }
+  Bucket &bucket = BucketOf (m_nextSlot);
+  if (!bucket.sorted)
+    {
+      std::sort (bucket.events.begin () + bucket.head, bucket.events.end (), EventBefore);
+      bucket.sorted = true;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+#ifndef TIMING_WHEEL_SCHEDULER_H
+#define TIMING_WHEEL_SCHEDULER_H
+
+#include "ns3/nstime.h"
+#include "ns3/scheduler.h"
+
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Event scheduler for short-horizon, regular workloads.
+ *
+ * Three tiers, the next event is the smallest head of the three:
+ *
+ *  - a fast lane for events at the current time, e.g. zero-delay probe
+ *    completions, kept in insertion (and thus uid) order;
+ *  - a timing wheel of Slots buckets of SlotWidth each, covering the near
+ *    future: probe intervals, transmit completions and on-off sends;
+ *  - an ordered overflow for events beyond the horizon of the wheel, which
+ *    are moved into the wheel as it turns.
+ *
+ * Inserts into the wheel are appends, a bucket is only sorted when it
+ * becomes the next one to run. Select with
+ * GlobalValue::Bind ("SchedulerType", StringValue ("ns3::TimingWheelScheduler")).
+ */
+class TimingWheelScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TimingWheelScheduler ();
+  virtual ~TimingWheelScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  struct Bucket {
+    std::vector<Event> events;
+    uint32_t head;    //!< First event not removed yet
+    bool sorted;
+  };
+
+  // Rebuilds the empty wheel after an attribute change.
+  void SetSlots (uint32_t slots);
+  uint32_t GetSlots (void) const { return m_slots; }
+  void SetSlotWidth (Time width);
+  Time GetSlotWidth (void) const { return m_slotWidth; }
+  void Resize (void);
+
+  uint64_t SlotOf (uint64_t ts) const { return ts >> m_shift; }
+  Bucket &BucketOf (uint64_t slot) { return m_buckets[slot & m_mask]; }
+  const Bucket &BucketOf (uint64_t slot) const { return m_buckets[slot & m_mask]; }
+
+  void InsertWheel (const Event &ev, uint64_t slot);
+  // Moves the wheel to the slot of the event just removed, takes over
+  // overflow events that came within the horizon.
+  void Advance (uint64_t slot);
+  // Finds the next non-empty bucket from m_nextSlot on and sorts it.
+  void FindNextSlot (void);
+
+  enum Tier {
+    FAST_LANE,
+    WHEEL,
+    OVERFLOW
+  };
+  Tier NextTier (void) const;
+
+  uint32_t m_slots;
+  Time m_slotWidth;
+  uint32_t m_shift;             //!< log2 of the slot width in time steps
+  uint64_t m_mask;
+  std::vector<Bucket> m_buckets;
+  uint64_t m_base;              //!< Slot of the last removed event
+  uint64_t m_nextSlot;          //!< First non-empty slot, if m_wheelCount > 0
+  uint64_t m_wheelCount;
+  uint64_t m_now;               //!< Timestamp of the last removed event
+  std::deque<Event> m_fastLane;
+  std::map<EventKey, EventImpl *> m_overflow;
+};
+
+} // namespace ns3
+
+#endif /* TIMING_WHEEL_SCHEDULER_H */
@@ -0,0 +1,38 @@
+#include "trace-context.h"
+
+#include "ns3/log.h"
+#include "ns3/packet-classifier.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-speedtest-sender.h"
+#include "ns3/trace-sender-application.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TraceContext");
+
+bool TraceContext::s_attached = false;
+uint32_t TraceContext::s_generation = 0;
+
+void
+TraceContext::DoAttach (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  s_attached = true;
+  // Destroy events run in order, the node list schedules its own on the
+  // first node, so applications are disposed before their ids go away.
+  Simulator::ScheduleDestroy (&TraceContext::Reset);
+}
+
+void
+TraceContext::Reset (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  TraceFlowManager::GetInstance ().Reset ();
+  TracePathManager::GetInstance ().Reset ();
+  SpeedtestManager::GetInstance ().Reset ();
+  PacketClassifier::GetInstance ().Reset ();
+  s_attached = false;
+  s_generation++;
+}
+
+} // namespace ns3
@@ -0,0 +1,45 @@
+#ifndef TRACE_CONTEXT_H
+#define TRACE_CONTEXT_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * Ties the registries of the tracing instrumentation to one simulation.
+ *
+ * TraceFlowManager, TracePathManager, SpeedtestManager and PacketClassifier
+ * are process wide singletons that hold raw pointers to applications of the
+ * running simulation. The first registration in any of them attaches the
+ * context, which schedules a reset with Simulator::ScheduleDestroy. Thus
+ * Simulator::Destroy returns all of them to their initial state and the next
+ * simulation of the same process starts with fresh flow, probe and route ids.
+ */
+class TraceContext
+{
+public:
+  // Schedules the reset for the current simulation, a flag test once done.
+  static void Attach (void)
+  {
+    if (!s_attached)
+      {
+        DoAttach ();
+      }
+  }
+
+  // Clears all registries now.
+  static void Reset (void);
+
+  // Number of resets so far.
+  static uint32_t GetGeneration (void) { return s_generation; }
+
+private:
+  static void DoAttach (void);
+
+  static bool s_attached;
+  static uint32_t s_generation;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_CONTEXT_H */
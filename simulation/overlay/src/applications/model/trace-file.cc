@@ -0,0 +1,222 @@
+#include "trace-file.h"
+
+#include "ns3/abort.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+
+static bool
+IsLittleEndianHost() {
+  uint16_t probe = 1;
+  uint8_t first;
+  std::memcpy(&first, &probe, 1);
+  return first == 1;
+}
+
+TraceFileColumn
+TraceFileWriter::MakeColumn(const char* name, TraceColumnType type) {
+  TraceFileColumn column;
+  std::memset(&column, 0, sizeof(column));
+  NS_ABORT_MSG_IF(std::strlen(name) >= TRACE_COLUMN_NAME_LEN, "TraceFile: Column name " << name << " too long!");
+  std::strncpy(column.name, name, TRACE_COLUMN_NAME_LEN - 1);
+  column.type = type;
+  return column;
+}
+
+bool
+TraceFileWriter::Open(const std::string& filename, const std::vector<TraceFileColumn>& schema,
+                      uint32_t from_node, uint32_t to_node, uint64_t resolution_ns) {
+  NS_ABORT_MSG_IF(!IsLittleEndianHost(), "TraceFile: Binary traces are only written on little-endian hosts!");
+  NS_ABORT_MSG_IF(schema.empty() || schema.size() > UINT16_MAX, "TraceFile: Invalid column count " << schema.size());
+  Close();
+
+  m_file = fopen(filename.c_str(), "wb");
+  if (!m_file) {
+    return false;
+  }
+
+  std::memset(&m_header, 0, sizeof(m_header));
+  std::memcpy(m_header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+  m_header.version = TRACE_FILE_VERSION;
+  m_header.column_count = static_cast<uint16_t>(schema.size());
+  m_header.row_size = static_cast<uint32_t>(schema.size() * sizeof(TraceCell));
+  m_header.from_node = from_node;
+  m_header.to_node = to_node;
+  m_header.resolution_ns = resolution_ns;
+  m_header.data_offset = sizeof(TraceFileHeader) + schema.size() * sizeof(TraceFileColumn);
+  m_routes.clear();
+
+  fwrite(&m_header, sizeof(m_header), 1, m_file);
+  fwrite(schema.data(), sizeof(TraceFileColumn), schema.size(), m_file);
+  return true;
+}
+
+void
+TraceFileWriter::WriteRow(const TraceCell* cells) {
+  fwrite(cells, sizeof(TraceCell), m_header.column_count, m_file);
+  m_header.row_count++;
+}
+
+void
+TraceFileWriter::AddRoute(uint32_t id, const std::vector<uint32_t>& nodes) {
+  m_routes.push_back({id, nodes});
+}
+
+void
+TraceFileWriter::Flush() {
+  if (m_file) {
+    fflush(m_file);
+  }
+}
+
+void
+TraceFileWriter::Close() {
+  if (!m_file) {
+    return;
+  }
+
+  m_header.routes_offset = m_header.data_offset + m_header.row_count * m_header.row_size;
+  uint64_t route_count = m_routes.size();
+  fwrite(&route_count, sizeof(route_count), 1, m_file);
+  for (const TraceRoute& route : m_routes) {
+    uint32_t entry[2] = {route.id, static_cast<uint32_t>(route.nodes.size())};
+    fwrite(entry, sizeof(entry), 1, m_file);
+    fwrite(route.nodes.data(), sizeof(uint32_t), route.nodes.size(), m_file);
+    if (route.nodes.size() % 2 != 0) {
+      uint32_t padding = 0;
+      fwrite(&padding, sizeof(padding), 1, m_file);
+    }
+  }
+
+  // row_count and routes_offset are only final now.
+  fseek(m_file, 0, SEEK_SET);
+  fwrite(&m_header, sizeof(m_header), 1, m_file);
+  fclose(m_file);
+  m_file = nullptr;
+}
+
+bool
+TraceFileReader::IsTraceFile(const std::string& filename) {
+  char magic[8] = {0};
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  size_t read = fread(magic, 1, sizeof(magic), file);
+  fclose(file);
+  return read == sizeof(magic) && std::memcmp(magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) == 0;
+}
+
+bool
+TraceFileReader::Open(const std::string& filename, std::string& error) {
+  NS_ABORT_MSG_IF(!IsLittleEndianHost(), "TraceFile: Binary traces are only read on little-endian hosts!");
+  Close();
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "Unable to open " + filename;
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TraceFileHeader)) {
+    close(fd);
+    error = filename + " is too short for a trace file";
+    return false;
+  }
+
+  void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    error = "Unable to map " + filename;
+    return false;
+  }
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = st.st_size;
+
+  const TraceFileHeader& header = Header();
+  if (std::memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC)) != 0) {
+    error = filename + " is not a binary trace file";
+  } else if (header.version != TRACE_FILE_VERSION) {
+    error = filename + " has unsupported version " + std::to_string(header.version);
+  } else if (header.routes_offset == 0) {
+    error = filename + " was not closed properly";
+  } else if (header.row_size != header.column_count * sizeof(TraceCell) ||
+             header.data_offset != sizeof(TraceFileHeader) + header.column_count * sizeof(TraceFileColumn) ||
+             header.routes_offset != header.data_offset + header.row_count * header.row_size ||
+             header.routes_offset + sizeof(uint64_t) > m_size) {
+    error = filename + " has an inconsistent header";
+  } else {
+    // Names are compared as C strings, each must end within its field.
+    for (uint16_t i = 0; i < header.column_count && error.empty(); i++) {
+      const TraceFileColumn& column = Columns()[i];
+      if (std::memchr(column.name, '\0', TRACE_COLUMN_NAME_LEN) == nullptr) {
+        error = filename + " has a column name without terminator in column " + std::to_string(i);
+      } else if (column.type != TRACE_COLUMN_U64 && column.type != TRACE_COLUMN_F64) {
+        error = filename + " has unknown type " + std::to_string(column.type) + " in column " + std::to_string(i);
+      }
+    }
+  }
+  if (!error.empty()) {
+    Close();
+    return false;
+  }
+
+  uint64_t offset = header.routes_offset;
+  uint64_t route_count;
+  std::memcpy(&route_count, m_data + offset, sizeof(route_count));
+  offset += sizeof(route_count);
+  for (uint64_t i = 0; i < route_count; i++) {
+    uint32_t entry[2];
+    if (offset + sizeof(entry) > m_size) {
+      break;
+    }
+    std::memcpy(entry, m_data + offset, sizeof(entry));
+    offset += sizeof(entry);
+
+    uint64_t padded = (entry[1] + entry[1] % 2) * sizeof(uint32_t);
+    if (offset + padded > m_size) {
+      break;
+    }
+    TraceRoute route;
+    route.id = entry[0];
+    route.nodes.resize(entry[1]);
+    std::memcpy(route.nodes.data(), m_data + offset, entry[1] * sizeof(uint32_t));
+    offset += padded;
+    m_routes.push_back(std::move(route));
+  }
+
+  if (m_routes.size() != route_count) {
+    error = filename + " has a truncated route dictionary";
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void
+TraceFileReader::Close() {
+  if (m_data) {
+    munmap(const_cast<uint8_t*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+  }
+  m_routes.clear();
+}
+
+int
+TraceFileReader::FindColumn(const std::string& name) const {
+  for (uint16_t i = 0; i < Header().column_count; i++) {
+    if (name == Columns()[i].name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+} // namespace ns3
@@ -0,0 +1,143 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Binary trace file layout (version 1, little-endian):
+ *
+ *   TraceFileHeader                  fixed 64 bytes
+ *   TraceFileColumn[column_count]    32 bytes each
+ *   rows[row_count]                  column_count cells of 8 bytes each
+ *   route dictionary                 at routes_offset
+ *
+ * Every cell is either an unsigned 64 bit integer or an IEEE double, so a
+ * row is a fixed-width struct and the row block can be memory-mapped and
+ * indexed directly. The route dictionary is a uint64_t route count followed
+ * by one entry per route: uint32_t route id, uint32_t node count and the
+ * uint32_t node ids, padded to 8 bytes.
+ *
+ * row_count and routes_offset are only known when the file is closed, a
+ * file with routes_offset 0 was not closed properly.
+ */
+#define TRACE_FILE_MAGIC "NSTRACE"
+#define TRACE_FILE_VERSION 1
+#define TRACE_COLUMN_NAME_LEN 24
+
+enum TraceColumnType : uint8_t {
+  TRACE_COLUMN_U64 = 0,
+  TRACE_COLUMN_F64 = 1
+};
+
+struct TraceFileHeader {
+  char magic[8];
+  uint16_t version;
+  uint16_t column_count;
+  uint32_t row_size;
+  uint32_t from_node;
+  uint32_t to_node;
+  uint64_t resolution_ns;  //!< Unit of time columns in nanoseconds
+  uint64_t data_offset;
+  uint64_t row_count;
+  uint64_t routes_offset;
+  uint64_t reserved;
+};
+
+struct TraceFileColumn {
+  char name[TRACE_COLUMN_NAME_LEN];
+  uint8_t type;
+  uint8_t padding[7];
+};
+
+union TraceCell {
+  uint64_t u;
+  double f;
+};
+
+static_assert(sizeof(TraceFileHeader) == 64, "TraceFileHeader must be 64 bytes");
+static_assert(sizeof(TraceFileColumn) == 32, "TraceFileColumn must be 32 bytes");
+static_assert(sizeof(TraceCell) == 8, "TraceCell must be 8 bytes");
+
+struct TraceRoute {
+  uint32_t id;
+  std::vector<uint32_t> nodes;
+};
+
+/**
+ * Writes a binary trace file row by row.
+ */
+class TraceFileWriter {
+public:
+  TraceFileWriter() : m_file(nullptr) {}
+  ~TraceFileWriter() { Close(); }
+
+  TraceFileWriter(const TraceFileWriter&) = delete;
+  TraceFileWriter& operator=(const TraceFileWriter&) = delete;
+
+  bool Open(const std::string& filename, const std::vector<TraceFileColumn>& schema,
+            uint32_t from_node, uint32_t to_node, uint64_t resolution_ns);
+  bool IsOpen() const { return m_file != nullptr; }
+
+  // cells must hold one value per schema column.
+  void WriteRow(const TraceCell* cells);
+  void AddRoute(uint32_t id, const std::vector<uint32_t>& nodes);
+  void Flush();
+
+  // Appends the route dictionary and patches the header.
+  void Close();
+
+  static TraceFileColumn MakeColumn(const char* name, TraceColumnType type);
+
+private:
+  FILE* m_file;
+  TraceFileHeader m_header;
+  std::vector<TraceRoute> m_routes;
+};
+
+/**
+ * Memory-maps a binary trace file written by TraceFileWriter.
+ */
+class TraceFileReader {
+public:
+  TraceFileReader() : m_data(nullptr), m_size(0) {}
+  ~TraceFileReader() { Close(); }
+
+  TraceFileReader(const TraceFileReader&) = delete;
+  TraceFileReader& operator=(const TraceFileReader&) = delete;
+
+  // Returns false and fills error if the file is missing or malformed.
+  bool Open(const std::string& filename, std::string& error);
+  void Close();
+
+  const TraceFileHeader& Header() const { return *reinterpret_cast<const TraceFileHeader*>(m_data); }
+  const TraceFileColumn* Columns() const {
+    return reinterpret_cast<const TraceFileColumn*>(m_data + sizeof(TraceFileHeader));
+  }
+
+  uint64_t Rows() const { return Header().row_count; }
+  const TraceCell* Row(uint64_t index) const {
+    return reinterpret_cast<const TraceCell*>(m_data + Header().data_offset + index * Header().row_size);
+  }
+
+  // Index of the named column or -1.
+  int FindColumn(const std::string& name) const;
+
+  const std::vector<TraceRoute>& Routes() const { return m_routes; }
+
+  static bool IsTraceFile(const std::string& filename);
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  std::vector<TraceRoute> m_routes;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_FILE_H */
@@ -0,0 +1,83 @@
+#include "trace-probe-scheduler.h"
+#include "trace-sender-application.h"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TraceProbeScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TraceProbeScheduler);
+
+TypeId
+TraceProbeScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TraceProbeScheduler")
+    .SetParent<Application> ()
+    .SetGroupName("Applications")
+    .AddConstructor<TraceProbeScheduler> ()
+    .AddAttribute ("ProbeInterval", "Interval for sending trace probes (ms)",
+                   UintegerValue (20),
+                   MakeUintegerAccessor (&TraceProbeScheduler::m_interval),
+                   MakeUintegerChecker<uint32_t> (1))
+  ;
+  return tid;
+}
+
+TraceProbeScheduler::TraceProbeScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TraceProbeScheduler::~TraceProbeScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TraceProbeScheduler::AddSender (Ptr<TraceSender> sender)
+{
+  NS_LOG_FUNCTION (this << sender);
+  sender->UseSharedTimer ();
+  m_senders.push_back (sender);
+}
+
+void
+TraceProbeScheduler::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_tickEvent);
+  m_senders.clear ();
+  Application::DoDispose ();
+}
+
+void
+TraceProbeScheduler::StartApplication ()
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_tickEvent);
+  m_tickEvent = Simulator::Schedule (MilliSeconds (m_interval), &TraceProbeScheduler::Tick, this);
+}
+
+void
+TraceProbeScheduler::StopApplication ()
+{
+  NS_LOG_FUNCTION (this);
+  Simulator::Cancel (m_tickEvent);
+}
+
+void
+TraceProbeScheduler::Tick ()
+{
+  NS_LOG_FUNCTION (this);
+
+  for (const Ptr<TraceSender> &sender : m_senders)
+    {
+      sender->SendProbe ();
+    }
+  m_tickEvent = Simulator::Schedule (MilliSeconds (m_interval), &TraceProbeScheduler::Tick, this);
+}
+
+} // namespace ns3
@@ -0,0 +1,47 @@
+#ifndef TRACE_PROBE_SCHEDULER_H
+#define TRACE_PROBE_SCHEDULER_H
+
+#include "ns3/application.h"
+#include "ns3/event-id.h"
+#include "ns3/ptr.h"
+
+#include <vector>
+
+namespace ns3 {
+
+class TraceSender;
+
+/**
+ * One probe timer shared by all TraceSenders of a node.
+ *
+ * Every ProbeInterval the scheduler lets each attached sender send one
+ * probe, so a node probing thousands of destinations costs one timer event
+ * per interval instead of one per destination.
+ */
+class TraceProbeScheduler : public Application
+{
+public:
+  static TypeId GetTypeId (void);
+  TraceProbeScheduler ();
+  virtual ~TraceProbeScheduler ();
+
+  void AddSender (Ptr<TraceSender> sender);
+  uint32_t GetNSenders (void) const { return m_senders.size (); }
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  virtual void StartApplication (void);
+  virtual void StopApplication (void);
+
+  void Tick ();
+
+  std::vector<Ptr<TraceSender>> m_senders;
+  uint32_t        m_interval;     //!< Probe interval (ms)
+  EventId         m_tickEvent;    //!< Next shared probe instant
+};
+
+} // namespace ns3
+
+#endif /* TRACE_PROBE_SCHEDULER_H */
@@ -165,11 +165,20 @@ void TraceReceiver::HandleRead (Ptr<Socket> socket)
           break;
         }
 
-      TraceSender *sender = TraceFlowManager::GetInstance().GetTraceSender(packet);
-      if (!sender) {
-        NS_LOG_ERROR ("TraceReceiver: " << packet->GetUid() << "  Packet not found!");
+      TraceFlowManager &flows = TraceFlowManager::GetInstance();
+      if (flows.IsDistributed()) {
+        // The sender may live on another rank, details are merged after the run.
+        TracePacketTag tag;
+        if (packet->FindFirstMatchingByteTag(tag)) {
+          flows.LogReception(tag.GetId(), m_node->GetId());
+        }
       } else {
-        sender->addReceptionDetails(packet, m_node->GetId());
+        TraceSender *sender = flows.GetTraceSender(packet);
+        if (!sender) {
+          NS_LOG_ERROR ("TraceReceiver: " << packet->GetUid() << "  Packet not found!");
+        } else {
+          sender->addReceptionDetails(packet, m_node->GetId());
+        }
       }
       
       m_totalRx += packet->GetSize ();
@@ -0,0 +1,90 @@
+#include "trace-record-store.h"
+#include "trace-sender-application.h"
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace ns3 {
+
+void
+TraceRecordStore::SetBlockSize(uint32_t size) {
+  NS_ABORT_MSG_IF(size == 0, "TraceRecordStore: Blocks need at least one record!");
+  NS_ABORT_MSG_IF(size != m_blockSize && (m_firstSeq != 1 || !m_records.empty()),
+                  "TraceRecordStore: Block size changed after the first record!");
+  m_blockSize = size;
+}
+
+TraceRecord&
+TraceRecordStore::Append(uint32_t seq, uint64_t send_time) {
+  NS_ABORT_MSG_IF(seq != m_firstSeq + m_records.size(), "TraceRecordStore: Probe sequence " << seq << " out of order!");
+
+  // The new record is the newest of its block, its tail starts over.
+  size_t block = (seq - 1) / m_blockSize - (m_firstSeq - 1) / m_blockSize;
+  if (block == m_tails.size()) {
+    m_tails.emplace_back();
+  }
+  BlockTail &tail = m_tails[block];
+  tail.max_link_cap = 0;
+  std::fill(tail.window_capacity, tail.window_capacity + RECORD_WINDOWS, 0.0f);
+
+  m_records.emplace_back();
+  TraceRecord &record = m_records.back();
+  record.send_time = send_time;
+  record.path_hash = TracePathManager::PATH_HASH_SEED;
+  record.min_link_cap = DBL_MAX;
+  record.delay = 0;
+  record.queue_sum = 0;
+  record.queue_bottleneck = 0;
+  record.queue_sum_to_bottleneck = 0;
+  record.hop_count = 0;
+  record.path_id = 0;
+  record.received = false;
+  return record;
+}
+
+void
+TraceRecordStore::AddHop(uint32_t seq, double link_capacity, uint32_t queue_capacity, uint32_t node,
+                         const double *window_caps, size_t windows) {
+  TraceRecord *record = Find(seq);
+  if (!record) return;
+
+  NS_ABORT_MSG_IF(record->hop_count == UINT16_MAX, "TraceRecordStore: Too many hops for probe!");
+
+  // Only the newest record of a block updates the tail of the block.
+  uint32_t last_seq = m_firstSeq + m_records.size() - 1;
+  if (seq % m_blockSize == 0 || seq == last_seq) {
+    BlockTail &tail = m_tails[(seq - 1) / m_blockSize - (m_firstSeq - 1) / m_blockSize];
+    tail.max_link_cap = std::max(tail.max_link_cap, link_capacity);
+    windows = std::min<size_t>(windows, RECORD_WINDOWS);
+    for (size_t i = 0; i < windows; i++) {
+      float capacity = static_cast<float>(window_caps[i]);
+      if (record->hop_count == 0 || capacity < tail.window_capacity[i]) {
+        tail.window_capacity[i] = capacity;
+      }
+    }
+  }
+
+  // The prefix sum is latched whenever a new bottleneck is found.
+  record->queue_sum = queue_capacity > UINT32_MAX - record->queue_sum ? UINT32_MAX : record->queue_sum + queue_capacity;
+  if (link_capacity < record->min_link_cap || record->hop_count == 0) {
+    record->min_link_cap = std::min(link_capacity, record->min_link_cap);
+    record->queue_bottleneck = queue_capacity;
+    record->queue_sum_to_bottleneck = record->queue_sum;
+  }
+  record->path_hash = TracePathManager::GetInstance().ExtendPath(record->path_hash, node);
+  record->hop_count++;
+}
+
+void
+TraceRecordStore::Release(size_t count) {
+  count = std::min(count, m_records.size());
+  m_records.erase(m_records.begin(), m_records.begin() + count);
+
+  size_t blocks = (m_firstSeq - 1 + count) / m_blockSize - (m_firstSeq - 1) / m_blockSize;
+  m_tails.erase(m_tails.begin(), m_tails.begin() + std::min(blocks, m_tails.size()));
+  m_firstSeq += count;
+}
+
+} // namespace ns3
@@ -0,0 +1,92 @@
+#ifndef TRACE_RECORD_STORE_H
+#define TRACE_RECORD_STORE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+namespace ns3 {
+
+/**
+ * Record of one probe. Hops are not kept, AddHop folds every hop into the
+ * values the summary rows need: the running path hash, the queue sums of
+ * all queue accumulation methods and the bottleneck seen so far.
+ */
+struct TraceRecord {
+  uint64_t send_time;
+  uint64_t path_hash;               //!< Hash of the nodes so far, see TracePathManager::ExtendPath
+  double min_link_cap;              //!< Smallest link capacity so far, the bottleneck
+  uint32_t delay;                   //!< One way delay (us) once received
+  uint32_t queue_sum;               //!< Queue capacities of all hops, saturating
+  uint32_t queue_bottleneck;        //!< Queue capacity at the bottleneck
+  uint32_t queue_sum_to_bottleneck; //!< Queue capacities up to the bottleneck
+  uint16_t hop_count;
+  uint16_t path_id;
+  bool received;
+};
+
+/**
+ * Sequence-indexed store of probe records for a single trace flow.
+ *
+ * Records are kept in one dense deque, the record of probe sequence number
+ * s lives at index (s - first sequence). Released records are popped from
+ * the front without moving the others. Blocks are runs of BlockSize
+ * records from sequence 1, every block keeps one BlockTail.
+ */
+class TraceRecordStore {
+public:
+  // Utilization windows of the devices kept per block, see
+  // PointToPointNetDevice::UtilizationWindows.
+  static const uint32_t RECORD_WINDOWS = 4;
+
+  // Link capacities of the newest record of a block, the rows report them
+  // for the last probe of the block only.
+  struct BlockTail {
+    double max_link_cap;
+    // Smallest available capacity over the hops per utilization window,
+    // shortest window first.
+    float window_capacity[RECORD_WINDOWS];
+  };
+
+  TraceRecordStore() : m_firstSeq(1), m_blockSize(1) {}
+
+  // Records per block, fixed once the first record is appended.
+  void SetBlockSize(uint32_t size);
+
+  TraceRecord& Append(uint32_t seq, uint64_t send_time);
+
+  TraceRecord* Find(uint32_t seq) {
+    uint64_t index = static_cast<uint64_t>(seq) - m_firstSeq;
+    return index < m_records.size() ? &m_records[index] : nullptr;
+  }
+
+  TraceRecord& operator[](size_t index) { return m_records[index]; }
+  const TraceRecord& operator[](size_t index) const { return m_records[index]; }
+
+  size_t Size() const { return m_records.size(); }
+  bool Empty() const { return m_records.empty(); }
+  uint32_t FirstSeq() const { return m_firstSeq; }
+
+  // Folds a hop into the record of seq. window_caps holds the available
+  // capacity per utilization window, shortest first.
+  void AddHop(uint32_t seq, double link_capacity, uint32_t queue_capacity, uint32_t node,
+              const double *window_caps, size_t windows);
+
+  // Tail of the block of the record at index.
+  const BlockTail& GetBlockTail(size_t index) const {
+    return m_tails[(m_firstSeq - 1 + index) / m_blockSize - (m_firstSeq - 1) / m_blockSize];
+  }
+
+  // Drops the oldest count records, and the tails of the blocks released completely.
+  void Release(size_t count);
+
+private:
+  std::deque<TraceRecord> m_records;
+  std::deque<BlockTail> m_tails;
+  uint32_t m_firstSeq;
+  uint32_t m_blockSize;
+};
+
+} // namespace ns3
+
+#endif /* TRACE_RECORD_STORE_H */
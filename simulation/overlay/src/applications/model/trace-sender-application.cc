@@ -16,14 +16,31 @@
 #include "ns3/uinteger.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/udp-socket-factory.h"
+#include "ns3/udp-l4-protocol.h"
 #include "ns3/string.h"
 #include "ns3/pointer.h"
 #include "ns3/boolean.h"
-
+#include "ns3/enum.h"
+#include "ns3/ipv4.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/point-to-point-channel.h"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/queue.h"
+#include "ns3/packet-classifier.h"
+
+#include <algorithm>
 #include <cfloat>
+#include <cmath>
+#include <sstream>
 #include <iostream>
 #include <cinttypes>
 
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("TraceSender");
@@ -40,11 +57,34 @@ TraceFlowManager::GetTraceSender(Ptr<const Packet> packet) {
   }
 }
 
+void
+TraceFlowManager::CountRecords(uint64_t& records, uint64_t& in_flight) const {
+  records = 0;
+  in_flight = 0;
+  for (const FlowSlot& slot : flow_table) {
+    if (slot.sender) {
+      records += slot.sender->GetLiveRecords();
+      in_flight += slot.sender->GetInFlightProbes();
+    }
+  }
+}
+
+void
+TraceFlowManager::Reset() {
+  flow_table.assign(1, FlowSlot{0, 1});
+  rank = 0;
+  ranks = 1;
+  distributed = false;
+  distributed_window = 0;
+  std::vector<TraceDistributedHop>().swap(hop_log);
+  std::vector<TraceDistributedReception>().swap(reception_log);
+}
+
 void
 TraceFlowManager::DebugTracePacket(Ptr<const Packet> packet) {
   TracePacketTag tag;
   if (packet->FindFirstMatchingByteTag(tag)) { 
-    if (packet_map.count(tag.GetId()) != 0) {
+    if (PacketToTraceSender(tag.GetId()) != 0) {
       std::cout << "Packet " << packet->GetUid() << ": Has tag and is mapped." << std::endl;
     } else {
       std::cout << "Packet " << packet->GetUid() << ": Has tag and is NOT mapped." << std::endl;
@@ -54,6 +94,194 @@ TraceFlowManager::DebugTracePacket(Ptr<const Packet> packet) {
   }
 }
 
+void
+TraceFlowManager::EnableDistributed(uint32_t system_id, uint32_t system_count) {
+  NS_ABORT_MSG_IF(flow_table.size() > 1, "TraceFlowManager: Distributed mode must be enabled before creating senders!");
+  NS_ABORT_MSG_IF(system_count > (1u << (32 - FLOW_INDEX_BITS)), "TraceFlowManager: Too many ranks for the flow id space!");
+  rank = system_id;
+  ranks = system_count;
+  distributed = true;
+  TraceContext::Attach();
+
+  // Logged hops are measured over the window senders are created with.
+  TypeId::AttributeInformation info;
+  TraceSender::GetTypeId().LookupAttributeByName("UtilizationWindow", &info);
+  distributed_window = DynamicCast<const TimeValue>(info.initialValue)->Get().GetNanoSeconds();
+
+  // Packet UIDs are only unique per rank, the UID cache could mix up a
+  // local packet with one received from another rank.
+  PacketClassifier::GetInstance().SetCacheEnabled(false);
+}
+
+void
+TraceFlowManager::LogHop(uint64_t packet_id, double link_load, const std::vector<double> &window_caps,
+                         uint64_t queue_cap, uint32_t at_node) {
+  TraceDistributedHop hop = {packet_id, static_cast<uint64_t>(Simulator::Now().GetNanoSeconds()), link_load, {},
+                             queue_cap, at_node, 0};
+  std::copy_n(window_caps.begin(), std::min<size_t>(window_caps.size(), TraceRecordStore::RECORD_WINDOWS), hop.window_capacity);
+  hop_log.push_back(hop);
+}
+
+void
+TraceFlowManager::LogReception(uint64_t packet_id, uint32_t at_node) {
+  reception_log.push_back({packet_id, static_cast<uint64_t>(Simulator::Now().GetMicroSeconds()), at_node, 0});
+}
+
+#ifdef NS3_MPI
+// Sends outgoing[r] to rank r and returns everything sent to this rank,
+// ordered by source rank.
+template <typename T>
+static std::vector<T>
+ExchangeEntries(const std::vector<std::vector<T>>& outgoing) {
+  int ranks = outgoing.size();
+  std::vector<int> send_counts(ranks), send_displs(ranks), recv_counts(ranks), recv_displs(ranks);
+  std::vector<T> send_buffer;
+  for (int r = 0; r < ranks; r++) {
+    send_displs[r] = send_buffer.size() * sizeof(T);
+    send_counts[r] = outgoing[r].size() * sizeof(T);
+    send_buffer.insert(send_buffer.end(), outgoing[r].begin(), outgoing[r].end());
+  }
+  MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+  int total = 0;
+  for (int r = 0; r < ranks; r++) {
+    recv_displs[r] = total;
+    total += recv_counts[r];
+  }
+  std::vector<T> received(total / sizeof(T));
+  MPI_Alltoallv(send_buffer.data(), send_counts.data(), send_displs.data(), MPI_BYTE,
+                received.data(), recv_counts.data(), recv_displs.data(), MPI_BYTE, MPI_COMM_WORLD);
+  return received;
+}
+
+// Concatenation of the words of all ranks, ordered by rank.
+static std::vector<uint64_t>
+GatherWords(const std::vector<uint64_t>& words, uint32_t ranks) {
+  int count = words.size();
+  std::vector<int> counts(ranks), displs(ranks);
+  MPI_Allgather(&count, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+  int total = 0;
+  for (uint32_t r = 0; r < ranks; r++) {
+    displs[r] = total;
+    total += counts[r];
+  }
+  std::vector<uint64_t> gathered(total);
+  MPI_Allgatherv(words.data(), count, MPI_UINT64_T, gathered.data(), counts.data(), displs.data(),
+                 MPI_UINT64_T, MPI_COMM_WORLD);
+  return gathered;
+}
+#endif
+
+void
+TraceFlowManager::MergeDistributed() {
+  if (!distributed) return;
+
+  std::vector<TraceDistributedHop> hops;
+  std::vector<TraceDistributedReception> receptions;
+#ifdef NS3_MPI
+  std::vector<std::vector<TraceDistributedHop>> hops_out(ranks);
+  std::vector<std::vector<TraceDistributedReception>> receptions_out(ranks);
+  for (const TraceDistributedHop& hop : hop_log) {
+    hops_out[FlowToRank(ProbeIdToFlow(hop.packet_id))].push_back(hop);
+  }
+  for (const TraceDistributedReception& reception : reception_log) {
+    receptions_out[FlowToRank(ProbeIdToFlow(reception.packet_id))].push_back(reception);
+  }
+  hops = ExchangeEntries(hops_out);
+  receptions = ExchangeEntries(receptions_out);
+#else
+  hops = hop_log;
+  receptions = reception_log;
+#endif
+  hop_log.clear();
+  hop_log.shrink_to_fit();
+  reception_log.clear();
+  reception_log.shrink_to_fit();
+
+  // Hops of one probe become adjacent and in path order, a probe needs
+  // positive link delay to reach its next hop.
+  std::stable_sort(hops.begin(), hops.end(), [](const TraceDistributedHop& a, const TraceDistributedHop& b) {
+    return a.packet_id != b.packet_id ? a.packet_id < b.packet_id : a.time < b.time;
+  });
+
+  // Route ids are handed out in first-seen order on a single process, so
+  // all ranks agree on the first reception time of every path first.
+  std::unordered_map<uint64_t, std::pair<uint64_t, std::vector<uint32_t>>> paths;
+  for (const TraceDistributedReception& reception : receptions) {
+    auto first = std::lower_bound(hops.begin(), hops.end(), reception.packet_id,
+                                  [](const TraceDistributedHop& hop, uint64_t id) { return hop.packet_id < id; });
+    uint64_t hash = TracePathManager::PATH_HASH_SEED;
+    std::vector<uint32_t> nodes;
+    for (auto hop = first; hop != hops.end() && hop->packet_id == reception.packet_id; hop++) {
+      hash = TracePathManager::ExtendPathHash(hash, hop->node);
+      nodes.push_back(hop->node);
+    }
+    hash = TracePathManager::ExtendPathHash(hash, reception.node);
+    nodes.push_back(reception.node);
+
+    auto it = paths.find(hash);
+    if (it == paths.end()) {
+      paths.emplace(hash, std::make_pair(reception.time, std::move(nodes)));
+    } else {
+      it->second.first = std::min(it->second.first, reception.time);
+    }
+  }
+
+  // Words of a path: first reception time, hash, node count, nodes.
+  std::vector<uint64_t> words;
+  for (const auto& path : paths) {
+    words.push_back(path.second.first);
+    words.push_back(path.first);
+    words.push_back(path.second.second.size());
+    words.insert(words.end(), path.second.second.begin(), path.second.second.end());
+  }
+#ifdef NS3_MPI
+  words = GatherWords(words, ranks);
+#endif
+
+  std::map<std::pair<uint64_t, uint64_t>, std::vector<uint32_t>> ordered;
+  std::unordered_map<uint64_t, uint64_t> first_seen;
+  for (size_t i = 0; i + 3 <= words.size(); ) {
+    uint64_t time = words[i], hash = words[i + 1], count = words[i + 2];
+    std::vector<uint32_t> nodes(words.begin() + i + 3, words.begin() + i + 3 + count);
+    i += 3 + count;
+
+    auto seen = first_seen.find(hash);
+    if (seen != first_seen.end()) {
+      if (seen->second <= time) continue;
+      ordered.erase({seen->second, hash});
+    }
+    first_seen[hash] = time;
+    ordered[{time, hash}] = std::move(nodes);
+  }
+
+  TracePathManager& path_manager = TracePathManager::GetInstance();
+  for (const auto& path : ordered) {
+    uint16_t id = path_manager.GetOrCreateRouteIdFromHash(path.first.second);
+    if (!path_manager.HasRoutePath(id)) {
+      path_manager.SetRoutePath(id, path.second);
+    }
+  }
+
+  for (const TraceDistributedHop& hop : hops) {
+    TraceSender* sender = PacketToTraceSender(hop.packet_id);
+    if (sender) {
+      sender->AddDistributedHop(ProbeIdToSeq(hop.packet_id), hop.link_load, hop.window_capacity,
+                                TraceRecordStore::RECORD_WINDOWS, hop.queue_cap, hop.node);
+    }
+  }
+  for (const TraceDistributedReception& reception : receptions) {
+    TraceSender* sender = PacketToTraceSender(reception.packet_id);
+    if (sender) {
+      sender->CompleteDistributedRecord(ProbeIdToSeq(reception.packet_id), reception.node, reception.time);
+    }
+  }
+
+  NS_LOG_INFO("Merged " << hops.size() << " hops, " << receptions.size() << " receptions and "
+              << ordered.size() << " routes on rank " << rank);
+}
+
 TypeId
 TraceSender::GetTypeId (void)
 {
@@ -69,6 +297,36 @@ TraceSender::GetTypeId (void)
                    UintegerValue (10),
                    MakeUintegerAccessor (&TraceSender::m_summary),
                    MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("StreamResults",
+                   "Write each summary row as soon as its block is complete instead of after the simulation",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TraceSender::m_stream),
+                   MakeBooleanChecker ())
+    .AddAttribute ("LossTimeout", "Time after which an unanswered probe is counted as lost when streaming (ms)",
+                   UintegerValue (1000),
+                   MakeUintegerAccessor (&TraceSender::m_lossTimeout),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddAttribute ("QueueAccumulation", "Queue accumulation method that feeds the queue_capacity column, "
+                   "all methods are written as queue_* columns as well",
+                   EnumValue (QueueAccumulationMethod::BOTTLENECK),
+                   MakeEnumAccessor<QueueAccumulationMethod> (&TraceSender::m_queueMode),
+                   MakeEnumChecker (QueueAccumulationMethod::SUM, "Sum",
+                                    QueueAccumulationMethod::BOTTLENECK, "Bottleneck",
+                                    QueueAccumulationMethod::SUM_TO_BOTTLENECK, "SumToBottleneck"))
+    .AddAttribute ("UtilizationWindow", "Window over which the link load of each hop is measured",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&TraceSender::m_utilizationWindow),
+                   MakeTimeChecker ())
+    .AddAttribute ("OutputFormat", "Format of the trace file, CSV or versioned binary columns",
+                   EnumValue (TraceOutputFormat::CSV),
+                   MakeEnumAccessor<TraceOutputFormat> (&TraceSender::m_outputFormat),
+                   MakeEnumChecker (TraceOutputFormat::CSV, "Csv",
+                                    TraceOutputFormat::BINARY, "Binary"))
+    .AddAttribute ("ProbeMode", "Inject probe packets or sample the routed path without sending",
+                   EnumValue (TraceProbeMode::PACKET),
+                   MakeEnumAccessor<TraceProbeMode> (&TraceSender::m_probeMode),
+                   MakeEnumChecker (TraceProbeMode::PACKET, "Packet",
+                                    TraceProbeMode::SHADOW, "Shadow"))
     .AddAttribute ("PacketSize", "The size of packets sent in on state",
                    UintegerValue (1),
                    MakeUintegerAccessor (&TraceSender::m_pktSize),
@@ -123,18 +381,6 @@ TraceSender::TraceSender ()
   NS_LOG_FUNCTION (this);
 }
 
-TraceElement::TraceElement ()
-  : receive_time (0),
-    path_id (0),
-    received (false),
-    hop_count (0)
-{
-  send_time = Simulator::Now().GetMicroSeconds();
-  link_capacities = {};
-  queue_capacities = {};
-  path = {};
-}
-
 TraceSender::~TraceSender()
 {
   NS_LOG_FUNCTION (this);
@@ -160,6 +406,11 @@ TraceSender::DoDispose (void)
   NS_LOG_FUNCTION (this);
 
   CancelEvents ();
+  if (IsTraceFileOpen ())
+    {
+      FinalizeBlocks (true);
+      CloseTraceFile ();
+    }
   m_socket = 0;
   Application::DoDispose ();
 }
@@ -168,7 +419,7 @@ void TraceSender::StartApplication ()
 {
   NS_LOG_FUNCTION (this);
 
-  if (!m_socket)
+  if (!m_socket && m_probeMode == TraceProbeMode::PACKET)
     {
       m_socket = Socket::CreateSocket (GetNode (), m_tid);
       int ret = -1;
@@ -207,6 +458,25 @@ void TraceSender::StartApplication ()
         MakeCallback (&TraceSender::ConnectionFailed, this));
     }
 
+  if (TraceFlowManager::GetInstance().IsDistributed ())
+    {
+      // Details of other ranks only arrive after the run.
+      NS_ABORT_MSG_IF (m_probeMode == TraceProbeMode::SHADOW, "Shadow probes are not supported in distributed runs");
+      NS_ABORT_MSG_IF (static_cast<uint64_t> (m_utilizationWindow.GetNanoSeconds ()) != TraceFlowManager::GetInstance().GetDistributedWindowNs (),
+                       "All TraceSenders of a distributed run must use the default UtilizationWindow");
+      if (m_stream)
+        {
+          NS_LOG_WARN ("TraceSender: Streaming is disabled in distributed runs");
+          m_stream = false;
+        }
+    }
+
+  if (m_stream && !IsTraceFileOpen ())
+    {
+      OpenTraceFile ();
+    }
+
+  m_running = true;
   CancelEvents ();
   StartSending ();
 }
@@ -215,12 +485,13 @@ void TraceSender::StopApplication ()
 {
   NS_LOG_FUNCTION (this);
 
+  m_running = false;
   CancelEvents ();
   if(m_socket)
     {
       m_socket->Close ();
     }
-  else
+  else if (m_probeMode == TraceProbeMode::PACKET)
     {
       NS_LOG_WARN ("TraceSender found null socket to close in StopApplication");
     }
@@ -237,7 +508,10 @@ void TraceSender::CancelEvents ()
 void TraceSender::StartSending ()
 {
   NS_LOG_FUNCTION (this);
-  ScheduleNextTx ();
+  if (!m_sharedTimer)
+    {
+      ScheduleNextTx ();
+    }
 }
 
 void TraceSender::ScheduleNextTx ()
@@ -254,6 +528,25 @@ void TraceSender::SendPacket ()
 
   NS_ASSERT (m_sendEvent.IsExpired ());
 
+  SendProbe ();
+  ScheduleNextTx ();
+}
+
+void TraceSender::SendProbe ()
+{
+  NS_LOG_FUNCTION (this);
+
+  if (!m_running)
+    {
+      return;
+    }
+
+  if (m_probeMode == TraceProbeMode::SHADOW)
+    {
+      SendShadowProbe ();
+      return;
+    }
+
   Ptr<Packet> probe_packet;
   if (m_enableSeqTsSizeHeader)
     {
@@ -273,15 +566,8 @@ void TraceSender::SendPacket ()
       probe_packet = Create<Packet> (m_pktSize);
     }
   
-  TracePacketTag tag(TraceFlowManager::GetInstance().RegisterTracePacket(m_flowId));
+  TracePacketTag tag(AppendRecord(Simulator::Now().GetMicroSeconds()));
   probe_packet->AddByteTag(tag);
-  Ptr<TraceElement> element = Create<TraceElement>();
-  m_trace_map[tag.GetId()] = element;
-
-  if (m_isFirstTransmission) {
-    m_firstTransmission = element->send_time;
-    m_isFirstTransmission = false;
-  }
 
   int actual = m_socket->Send (probe_packet);
   if ((unsigned) actual == m_pktSize)
@@ -316,143 +602,395 @@ void TraceSender::SendPacket ()
       NS_LOG_INFO ("Unable Send trace packet!");
       NS_LOG_DEBUG ("Unable to send m_probe_packet; actual " << actual << " size " << m_pktSize << "; caching for later attempt");
     }
-  ScheduleNextTx ();
+
+  if (IsTraceFileOpen ())
+    {
+      FinalizeBlocks (false);
+    }
 }
 
-void TraceSender::WriteResults(QueueAccumulationMethod mode) {
-  std::vector<std::vector<std::pair<uint64_t, Ptr<TraceElement>>>> blocks;
-  std::vector<std::pair<uint64_t, Ptr<TraceElement>>> currentBlock;
+uint64_t TraceSender::AppendRecord(uint64_t send_time) {
+  uint64_t id = TraceFlowManager::GetInstance().RegisterTracePacket(m_flowId);
+  m_records.SetBlockSize(m_summary);
+  TraceRecord &record = m_records.Append(TraceFlowManager::ProbeIdToSeq(id), send_time);
 
-  for (const auto& entry : m_trace_map) {
-    currentBlock.push_back(entry);
-    if (currentBlock.size() == m_summary) {
-      blocks.push_back(std::move(currentBlock));
-      currentBlock.clear();
-    }
+  if (m_isFirstTransmission) {
+    m_firstTransmission = record.send_time;
+    m_isFirstTransmission = false;
   }
+  return id;
+}
 
-  if (currentBlock.size() != 0) {
-    blocks.push_back(std::move(currentBlock));
-  }
+void TraceSender::SendShadowProbe ()
+{
+  NS_LOG_FUNCTION (this);
+
+  uint32_t seq = TraceFlowManager::ProbeIdToSeq(AppendRecord(Simulator::Now().GetMicroSeconds()));
+  TraceRecord &record = *m_records.Find(seq);
+
+  NS_ABORT_MSG_IF (!InetSocketAddress::IsMatchingType (m_peer), "Shadow probes need an IPv4 remote address");
+  Ipv4Header header;
+  header.SetDestination (InetSocketAddress::ConvertFrom (m_peer).GetIpv4 ());
+  header.SetProtocol (UdpL4Protocol::PROT_NUMBER);
 
+  // Probe packets leave a device without transmission time, so a probe sees
+  // the backlog of every device plus the propagation delay of every link.
+  Ptr<Node> node = GetNode ();
+  Time delay = Seconds (0);
+  for (uint32_t ttl = 64; ttl > 0; ttl--)
+    {
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      if (ipv4->GetInterfaceForAddress (header.GetDestination ()) >= 0)
+        {
+          CompleteRecord (record, node->GetId (), record.send_time + delay.GetMicroSeconds ());
+          return;
+        }
+
+      Socket::SocketErrno err;
+      Ptr<Ipv4Route> route = ipv4->GetRoutingProtocol ()->RouteOutput (nullptr, header, nullptr, err);
+      Ptr<PointToPointNetDevice> device = route ? DynamicCast<PointToPointNetDevice> (route->GetOutputDevice ()) : nullptr;
+      if (!device)
+        {
+          NS_LOG_DEBUG ("Shadow probe of flow " << m_flowId << " has no point-to-point route at node " << node->GetId ());
+          break;
+        }
+
+      // A full queue would have dropped the probe.
+      Ptr<Queue<Packet>> queue = device->GetQueue ();
+      uint64_t queue_free = queue->GetMaxSize ().GetValue () - queue->GetNPackets ();
+      if (queue_free == 0)
+        {
+          break;
+        }
+      device->GetDeviceUtilizations (m_hopCapacities);
+      AddHop (seq, device->GetDeviceUtilization (GetSummaryIntervalNs ()), m_hopCapacities.data (),
+              m_hopCapacities.size (), queue_free, node->GetId ());
+
+      Ptr<PointToPointChannel> channel = DynamicCast<PointToPointChannel> (device->GetChannel ());
+      TimeValue propagation;
+      channel->GetAttribute ("Delay", propagation);
+      delay += device->GetBacklogDelay () + propagation.Get ();
+
+      Ptr<NetDevice> peer = channel->GetDevice (0) == device ? channel->GetDevice (1) : channel->GetDevice (0);
+      node = peer->GetNode ();
+    }
+
+  // Unreachable destinations stay unanswered and are counted as lost.
+  if (IsTraceFileOpen ())
+    {
+      FinalizeBlocks (false);
+    }
+}
+
+std::string TraceSender::GetTraceFileName() const {
   std::ostringstream oss;
-  oss << "trace_" << m_fromNode << "_to_" << m_toNode << ".csv";
-  std::string filename =  oss.str();
+  oss << "trace_" << m_fromNode << "_to_" << m_toNode
+      << (m_outputFormat == TraceOutputFormat::BINARY ? ".trace" : ".csv");
+  return oss.str();
+}
+
+// Columns of a summary row, in the order of the CSV header and the binary schema.
+static const struct {
+  const char *name;
+  TraceColumnType type;
+} TRACE_COLUMNS[] = {
+  {"at", TRACE_COLUMN_U64},
+  {"delay", TRACE_COLUMN_U64},
+  {"stddev", TRACE_COLUMN_F64},
+  {"min_link_cap", TRACE_COLUMN_F64},
+  {"max_link_cap", TRACE_COLUMN_F64},
+  {"queue_capacity", TRACE_COLUMN_U64},
+  {"hops", TRACE_COLUMN_U64},
+  {"dropratio", TRACE_COLUMN_F64},
+  {"route", TRACE_COLUMN_U64},
+  {"delay_p50", TRACE_COLUMN_U64},
+  {"delay_p90", TRACE_COLUMN_U64},
+  {"delay_p99", TRACE_COLUMN_U64},
+  {"delay_max", TRACE_COLUMN_U64},
+  {"queue_sum", TRACE_COLUMN_U64},
+  {"queue_bottleneck", TRACE_COLUMN_U64},
+  {"queue_sum_to_bottleneck", TRACE_COLUMN_U64},
+};
+static const size_t TRACE_COLUMN_COUNT = sizeof(TRACE_COLUMNS) / sizeof(TRACE_COLUMNS[0]);
+
+// Name of the link_cap column of a window, in the largest unit that fits
+// exactly, e.g. link_cap_10ms.
+static std::string CapacityColumnName(uint64_t window_ns) {
+  static const struct {
+    uint64_t ns;
+    const char *unit;
+  } units[] = {{1000000000, "s"}, {1000000, "ms"}, {1000, "us"}, {1, "ns"}};
+
+  std::ostringstream oss;
+  for (const auto &unit : units) {
+    if (window_ns % unit.ns == 0) {
+      oss << "link_cap_" << window_ns / unit.ns << unit.unit;
+      break;
+    }
+  }
+  return oss.str();
+}
+
+void TraceSender::OpenTraceFile() {
+  std::string filename = GetTraceFileName();
   NS_LOG_UNCOND ("Wrting trace file to " << filename << " ... ");
+  m_runDelays.Reset();
+
+  // One column per utilization window of the devices, as configured by
+  // default. Hops report their windows in the same order.
+  TypeId::AttributeInformation info;
+  PointToPointNetDevice::GetTypeId().LookupAttributeByName("UtilizationWindows", &info);
+  m_capacityWindows = PointToPointNetDevice::ParseUtilizationWindows(
+    DynamicCast<const StringValue>(info.initialValue)->Get());
+  if (m_capacityWindows.size() > TraceRecordStore::RECORD_WINDOWS) {
+    NS_LOG_WARN ("Only the " << TraceRecordStore::RECORD_WINDOWS << " shortest utilization windows are traced");
+    m_capacityWindows.resize(TraceRecordStore::RECORD_WINDOWS);
+  }
 
-  FILE* trace_csv = fopen(filename.c_str(), "w+");
+  if (m_outputFormat == TraceOutputFormat::BINARY) {
+    std::vector<TraceFileColumn> schema;
+    for (size_t i = 0; i < TRACE_COLUMN_COUNT; i++) {
+      schema.push_back(TraceFileWriter::MakeColumn(TRACE_COLUMNS[i].name, TRACE_COLUMNS[i].type));
+    }
+    for (uint64_t window : m_capacityWindows) {
+      schema.push_back(TraceFileWriter::MakeColumn(CapacityColumnName(window).c_str(), TRACE_COLUMN_F64));
+    }
 
-  fprintf(trace_csv, "at,delay,stddev,min_link_cap,max_link_cap,queue_capacity,hops,dropratio,route\n");
+    // Time columns are in microseconds.
+    bool opened = m_binaryTrace.Open(filename, schema, m_fromNode, m_toNode, 1000);
+    NS_ABORT_MSG_IF(!opened, "Unable to open trace file " << filename);
+    m_routeWritten.assign(UINT16_MAX + 1, false);
+    return;
+  }
 
-  for (const auto& block : blocks) {
-    if (block.size() == 0) continue;
+  m_traceFile = fopen(filename.c_str(), "w+");
+  NS_ABORT_MSG_IF(!m_traceFile, "Unable to open trace file " << filename);
 
-    uint64_t delay = 0;
-    uint64_t delay_entries = 0;
-    double min_link_cap = 0;
-    double max_link_cap  = 0;
-    uint64_t queue_capacity = 0;
-    uint32_t hops = block[0].second->hop_count;
-    uint64_t drops = 0;
-    uint16_t route = block[0].second->path_id;
+  for (size_t i = 0; i < TRACE_COLUMN_COUNT; i++) {
+    fprintf(m_traceFile, i == 0 ? "%s" : ",%s", TRACE_COLUMNS[i].name);
+  }
+  for (uint64_t window : m_capacityWindows) {
+    fprintf(m_traceFile, ",%s", CapacityColumnName(window).c_str());
+  }
+  fprintf(m_traceFile, "\n");
+}
+
+void TraceSender::CloseTraceFile() {
+  if (m_traceFile) {
+    fclose(m_traceFile);
+    m_traceFile = nullptr;
+  }
+  m_binaryTrace.Close();
+  NS_LOG_UNCOND ("Closed trace file " << GetTraceFileName() << " (delay p50=" << m_runDelays.Percentile(50)
+                 << "us, p90=" << m_runDelays.Percentile(90) << "us, p99=" << m_runDelays.Percentile(99)
+                 << "us, max=" << m_runDelays.Max() << "us)");
+}
 
-    if (route == 0) {
-      route = block[block.size() - 1].second->path_id;
+void TraceSender::WriteResults() {
+  WriteResults(m_queueMode);
+}
+
+void TraceSender::WriteResults(QueueAccumulationMethod mode) {
+  if (IsTraceFileOpen()) {
+    // Rows were streamed during the run, only the remaining blocks are left.
+    if (mode != m_queueMode) {
+      NS_LOG_WARN ("Streamed trace rows use the configured QueueAccumulation method");
     }
+    FinalizeBlocks(true);
+    CloseTraceFile();
+    return;
+  }
 
-    for (const auto& entry : block) {
-      auto& value = entry.second;
+  OpenTraceFile();
 
-      double min_link_cap_search = DBL_MAX;
-      double max_link_cap_search  = 0;
-      if (value->receive_time != 0) {
-        delay += value->receive_time - value->send_time;
-        delay_entries++;
-      } else {
-        drops++;
-      }
+  // Blocks are consecutive runs of m_summary records in sequence order.
+  for (size_t first = 0; first < m_records.Size(); first += m_summary) {
+    WriteBlock(first, std::min<size_t>(m_summary, m_records.Size() - first), mode);
+  }
 
-      long unsigned int bottleneck_at = 0;
-      for (long unsigned int index = 0; index < value->link_capacities.size(); index++) {
-        double link_cap = value->link_capacities[index];
-        if (link_cap > max_link_cap_search) {
-          max_link_cap_search = link_cap;
-        }
+  CloseTraceFile();
+}
 
-        if (link_cap < min_link_cap_search) {
-          min_link_cap_search = link_cap;
-          bottleneck_at = index;
-        }
-      }
+uint64_t TraceSender::GetInFlightProbes() const {
+  uint64_t now = Simulator::Now().GetMicroSeconds();
+  uint64_t timeout = static_cast<uint64_t>(m_lossTimeout) * 1000;
 
-      min_link_cap = min_link_cap_search;
-      max_link_cap = max_link_cap_search;
+  // Only the newest records can still be answered, scan back until the timeout.
+  uint64_t in_flight = 0;
+  for (size_t i = m_records.Size(); i > 0 && now - m_records[i - 1].send_time < timeout; i--) {
+    in_flight += m_records[i - 1].received ? 0 : 1;
+  }
+  return in_flight;
+}
 
-      if (value->queue_capacities.size() != value->link_capacities.size()) {
-        NS_ABORT_MSG("Queue slot and link capacity slot mismatch!");
-      }
+void TraceSender::FinalizeBlocks(bool force) {
+  uint64_t now = Simulator::Now().GetMicroSeconds();
+  uint64_t timeout = static_cast<uint64_t>(m_lossTimeout) * 1000;
 
-      switch (mode) {
-        case QueueAccumulationMethod::SUM:
-          for (long unsigned int index = 0; index < value->queue_capacities.size(); index++) {
-            queue_capacity += value->queue_capacities[index];
-          }
-          break;
-        case QueueAccumulationMethod::BOTTLENECK:
-          if (bottleneck_at >= value->queue_capacities.size()) {
-            if (value->queue_capacities.size() == 0) {
-              queue_capacity = 0;
-            } else {
-              queue_capacity = value->queue_capacities[value->queue_capacities.size() - 1];
-            }
-          } else {
-            queue_capacity += value->queue_capacities[bottleneck_at];
-          }
-          break;
-        case QueueAccumulationMethod::SUM_TO_BOTTLENECK:
-          for (long unsigned int index = 0; index <= std::min(bottleneck_at, std::max(value->queue_capacities.size() - 1, 0UL)); index++) {
-            queue_capacity += value->queue_capacities[index];
-          }
-          break;
+  while (!m_records.Empty()) {
+    size_t count = std::min<size_t>(m_summary, m_records.Size());
+
+    if (!force) {
+      if (count < m_summary) break;
+
+      // A full block is done once every probe arrived or the newest one timed out.
+      bool pending = false;
+      for (size_t i = 0; i < count && !pending; i++) {
+        pending = !m_records[i].received;
       }
+      if (pending && now - m_records[count - 1].send_time < timeout) break;
     }
 
-    double dropratio = (double) drops / block.size();
-    queue_capacity /= block.size();
-    uint64_t avg_delay = 0;
-    double std_dev = 0.0;
-    if (delay_entries != 0) {
-      avg_delay = delay / delay_entries;
+    WriteBlock(0, count, m_queueMode);
+    m_records.Release(count);
+  }
 
-      for (const auto& entry : block) {
-        auto& value = entry.second;
+  if (m_traceFile) {
+    fflush(m_traceFile);
+  }
+  m_binaryTrace.Flush();
+}
+
+void TraceSender::WriteBlock(size_t first, size_t count, QueueAccumulationMethod mode) {
+  const TraceRecord &head = m_records[first];
+  // Link capacities are those of the last probe of the block.
+  const TraceRecord &last = m_records[first + count - 1];
+  const TraceRecordStore::BlockTail &tail = m_records.GetBlockTail(first + count - 1);
+
+  uint64_t delay = 0;
+  uint64_t delay_entries = 0;
+  double delay_mean = 0.0;
+  double delay_m2 = 0.0;
+  double min_link_cap = last.min_link_cap;
+  double max_link_cap = tail.max_link_cap;
+  uint64_t queue_sum = 0;
+  uint64_t queue_bottleneck = 0;
+  uint64_t queue_sum_to_bottleneck = 0;
+  uint32_t hops = head.hop_count;
+  uint64_t drops = 0;
+  uint16_t route = head.path_id;
+
+  if (route == 0) {
+    route = last.path_id;
+  }
 
-        if (value->receive_time == 0) continue;
+  for (size_t i = first; i < first + count; i++) {
+    const TraceRecord &value = m_records[i];
 
-        uint64_t delay_b = value->receive_time - value->send_time;
-        std_dev += pow((((double) delay_b - (double) avg_delay)), 2);
-      }
+    if (value.received) {
+      uint64_t delay_b = value.delay;
+      delay += delay_b;
+      delay_entries++;
+      m_blockDelays.Add(delay_b);
 
-      std_dev = sqrt(std_dev / delay_entries);
+      // Welford's online update of mean and squared deviations.
+      double diff = (double) delay_b - delay_mean;
+      delay_mean += diff / delay_entries;
+      delay_m2 += diff * ((double) delay_b - delay_mean);
     } else {
-      dropratio = 1.0;
+      drops++;
     }
 
-    fprintf(trace_csv, "%" PRIu64 ",%" PRIu64 ",%.2f,%.2f,%.2f,%" PRIu64 ",%" PRIu32 ",%.2f,%" PRIu16 "\n",
-      block[0].second->send_time - m_firstTransmission,
-      avg_delay,
-      std_dev,
-      min_link_cap,
-      max_link_cap,
-      queue_capacity,
-      hops,
-      dropratio,
-      route
-    );
+    // The queue values of all accumulation methods were folded in per hop.
+    queue_sum += value.queue_sum;
+    queue_sum_to_bottleneck += value.queue_sum_to_bottleneck;
+    if (value.hop_count == 0) {
+      queue_bottleneck = 0;
+    } else {
+      queue_bottleneck += value.queue_bottleneck;
+    }
+  }
+
+  queue_sum /= count;
+  queue_bottleneck /= count;
+  queue_sum_to_bottleneck /= count;
+
+  uint64_t queue_capacity = 0;
+  switch (mode) {
+    case QueueAccumulationMethod::SUM:
+      queue_capacity = queue_sum;
+      break;
+    case QueueAccumulationMethod::BOTTLENECK:
+      queue_capacity = queue_bottleneck;
+      break;
+    case QueueAccumulationMethod::SUM_TO_BOTTLENECK:
+      queue_capacity = queue_sum_to_bottleneck;
+      break;
+  }
+
+  double dropratio = (double) drops / count;
+  uint64_t avg_delay = 0;
+  double std_dev = 0.0;
+  if (delay_entries != 0) {
+    avg_delay = delay / delay_entries;
+
+    // The reported deviation is taken around the truncated average delay.
+    double offset = delay_mean - (double) avg_delay;
+    std_dev = sqrt(delay_m2 / delay_entries + offset * offset);
+  } else {
+    dropratio = 1.0;
+  }
+
+  uint64_t delay_p50 = m_blockDelays.Percentile(50);
+  uint64_t delay_p90 = m_blockDelays.Percentile(90);
+  uint64_t delay_p99 = m_blockDelays.Percentile(99);
+  uint64_t delay_max = m_blockDelays.Max();
+  m_runDelays.Merge(m_blockDelays);
+  m_blockDelays.Reset();
+
+  if (m_binaryTrace.IsOpen()) {
+    if (route != 0 && !m_routeWritten[route]) {
+      m_binaryTrace.AddRoute(route, TracePathManager::GetInstance().GetRoutePath(route));
+      m_routeWritten[route] = true;
+    }
+
+    TraceCell row[TRACE_COLUMN_COUNT + TraceRecordStore::RECORD_WINDOWS];
+    row[0].u = head.send_time - m_firstTransmission;
+    row[1].u = avg_delay;
+    row[2].f = std_dev;
+    row[3].f = min_link_cap;
+    row[4].f = max_link_cap;
+    row[5].u = queue_capacity;
+    row[6].u = hops;
+    row[7].f = dropratio;
+    row[8].u = route;
+    row[9].u = delay_p50;
+    row[10].u = delay_p90;
+    row[11].u = delay_p99;
+    row[12].u = delay_max;
+    row[13].u = queue_sum;
+    row[14].u = queue_bottleneck;
+    row[15].u = queue_sum_to_bottleneck;
+    for (size_t i = 0; i < m_capacityWindows.size(); i++) {
+      row[TRACE_COLUMN_COUNT + i].f = tail.window_capacity[i];
+    }
+    m_binaryTrace.WriteRow(row);
+    return;
   }
 
-  fclose(trace_csv);
-  NS_LOG_UNCOND ("Closed trace file " << filename);
+  fprintf(m_traceFile, "%" PRIu64 ",%" PRIu64 ",%.2f,%.2f,%.2f,%" PRIu64 ",%" PRIu32 ",%.2f,%" PRIu16
+    ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+    head.send_time - m_firstTransmission,
+    avg_delay,
+    std_dev,
+    min_link_cap,
+    max_link_cap,
+    queue_capacity,
+    hops,
+    dropratio,
+    route,
+    delay_p50,
+    delay_p90,
+    delay_p99,
+    delay_max,
+    queue_sum,
+    queue_bottleneck,
+    queue_sum_to_bottleneck
+  );
+  for (size_t i = 0; i < m_capacityWindows.size(); i++) {
+    fprintf(m_traceFile, ",%.2f", tail.window_capacity[i]);
+  }
+  fprintf(m_traceFile, "\n");
 }
 
 void TraceSender::ConnectionSucceeded (Ptr<Socket> socket)
@@ -467,21 +1005,26 @@ void TraceSender::ConnectionFailed (Ptr<Socket> socket)
   NS_FATAL_ERROR ("Can't connect");
 }
 
-void TraceSender::addHopDetails(Ptr<const Packet> packet, double link_load, uint64_t queue_cap, uint32_t at_node) {
+TraceRecord* TraceSender::getRecord(Ptr<const Packet> packet) {
+  TracePacketTag tag;
+  if (!packet->FindFirstMatchingByteTag(tag)) return nullptr;
+
+  return m_records.Find(TraceFlowManager::ProbeIdToSeq(tag.GetId()));
+}
+
+void TraceSender::addHopDetails(Ptr<const Packet> packet, double link_load, const std::vector<double> &window_caps,
+                                uint64_t queue_cap, uint32_t at_node) {
   TracePacketTag tag;
   if (!packet->FindFirstMatchingByteTag(tag)) return;
 
-  Ptr<TraceElement> element = m_trace_map.at(tag.GetId());
+  AddHop(TraceFlowManager::ProbeIdToSeq(tag.GetId()), link_load, window_caps.data(), window_caps.size(), queue_cap,
+         at_node);
+}
 
-  if (at_node != m_node->GetId()) {
-    element->queue_capacities.push_back(queue_cap);
-  } else {
-    element->queue_capacities.push_back(0);
-  }
-  element->path.push_back(at_node);
-  element->link_capacities.push_back(link_load);
-  element->transmit_times.push_back(Simulator::Now().GetMicroSeconds());
-  element->hop_count++;
+void TraceSender::AddHop(uint32_t seq, double link_load, const double *window_caps, size_t windows,
+                         uint64_t queue_cap, uint32_t at_node) {
+  uint32_t queue = at_node != m_node->GetId() ? static_cast<uint32_t>(std::min<uint64_t>(queue_cap, UINT32_MAX)) : 0;
+  m_records.AddHop(seq, link_load, queue, at_node, window_caps, windows);
 }
 
 uint64_t TraceSender::getPacketId(Ptr<const Packet> packet) {
@@ -494,25 +1037,48 @@ uint64_t TraceSender::getPacketId(Ptr<const Packet> packet) {
   return tag.GetId();
 }
 
+void TraceSender::AddDistributedHop(uint32_t seq, double link_load, const double *window_caps, size_t windows,
+                                    uint64_t queue_cap, uint32_t at_node) {
+  AddHop(seq, link_load, window_caps, windows, queue_cap, at_node);
+}
+
+void TraceSender::CompleteDistributedRecord(uint32_t seq, uint32_t at_node, uint64_t receive_time) {
+  TraceRecord *record = m_records.Find(seq);
+  if (!record) return;
+
+  CompleteRecord(*record, at_node, receive_time);
+}
+
 void TraceSender::addReceptionDetails(Ptr<const Packet> packet, uint32_t at_node) {
-  TracePacketTag tag;
-  if (!packet->FindFirstMatchingByteTag(tag)) return;
+  TraceRecord *record = getRecord(packet);
+  if (!record) return;
 
-  Ptr<TraceElement> element = m_trace_map.at(tag.GetId());
-  element->path.push_back(at_node);
-  element->path_id = TracePathManager::GetInstance().GetOrCreateRouteId(element->path);
-  element->path.clear();
-  element->receive_time = Simulator::Now().GetMicroSeconds();
-  element->received = true;
+  CompleteRecord(*record, at_node, Simulator::Now().GetMicroSeconds());
 }
 
-void TraceSender::debugTraceElement(Ptr<const Packet> packet) {
-  TracePacketTag tag;
-  if (!packet->FindFirstMatchingByteTag(tag)) return;
+void TraceSender::CompleteRecord(TraceRecord &record, uint32_t at_node, uint64_t receive_time) {
+  TracePathManager &path_manager = TracePathManager::GetInstance();
+  uint64_t path_hash = path_manager.ExtendPath(record.path_hash, at_node);
+
+  record.path_id = path_manager.GetOrCreateRouteIdFromHash(path_hash);
+  record.delay = static_cast<uint32_t>(std::min<uint64_t>(receive_time - record.send_time, UINT32_MAX));
+  record.received = true;
+
+  if (!path_manager.HasRoutePath(record.path_id)) {
+    path_manager.SetRoutePath(record.path_id, path_manager.GetPathNodes(path_hash));
+  }
+
+  if (IsTraceFileOpen()) {
+    FinalizeBlocks(false);
+  }
+}
+
+void TraceSender::debugTraceRecord(Ptr<const Packet> packet) {
+  TraceRecord *record = getRecord(packet);
+  if (!record) return;
 
-  Ptr<TraceElement> element = m_trace_map.at(tag.GetId());
-  NS_LOG_INFO ("--- TracePacket id=" << tag.GetId() << ", flow=" << m_flowId);
-  NS_LOG_INFO ("Sended: " << element->send_time << ", Received: " << element->receive_time << ", Took: " << element->receive_time - element->send_time);
+  NS_LOG_INFO ("--- TracePacket id=" << getPacketId(packet) << ", flow=" << m_flowId);
+  NS_LOG_INFO ("Sended: " << record->send_time << ", Received: " << record->send_time + record->delay << ", Took: " << record->delay);
   NS_LOG_INFO ("-----------------------");
 }
 
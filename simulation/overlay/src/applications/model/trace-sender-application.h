@@ -8,13 +8,21 @@
 #include "ns3/data-rate.h"
 #include "ns3/traced-callback.h"
 #include "ns3/seq-ts-size-header.h"
+#include "ns3/abort.h"
+#include "trace-record-store.h"
+#include "trace-file.h"
+#include "delay-histogram.h"
+#include "trace-context.h"
 
+#include <algorithm>
 #include <map>
 #include <tuple>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
 #include <functional>
+#include <cstdio>
+#include <string>
 
 namespace ns3 {
 
@@ -22,21 +30,6 @@ class Address;
 class RandomVariableStream;
 class Socket;
 
-class TraceElement : public Object {
-public:
-  uint64_t send_time;
-  uint64_t receive_time ;
-  std::vector<double> link_capacities;
-  std::vector<uint64_t> queue_capacities;
-  std::vector<uint64_t> transmit_times;
-  std::vector<uint64_t> path;
-  uint16_t path_id;
-  bool received;
-  uint32_t hop_count;
-
-  TraceElement();
-};
-
 class TracePacketTag : public ns3::Tag {
 public:
   TracePacketTag() : m_id(0) {}
@@ -79,6 +72,20 @@ enum class QueueAccumulationMethod {
   SUM_TO_BOTTLENECK
 };
 
+enum class TraceOutputFormat {
+  CSV,
+  BINARY
+};
+
+/**
+ * PACKET injects real probe packets, SHADOW walks the routed path at every
+ * probe instant and samples the devices on it without sending anything.
+ */
+enum class TraceProbeMode {
+  PACKET,
+  SHADOW
+};
+
 class TraceSender : public Application 
 {
 public:
@@ -92,15 +99,39 @@ public:
   void debugTracePacket(Ptr<const Packet> packet);
   uint64_t getPacketId(Ptr<const Packet> packet);
 
-  void addHopDetails(Ptr<const Packet> packet, double link_load, uint64_t queue_cap, uint32_t at_node);
+  // window_caps holds the available capacity of the device per utilization
+  // window, shortest first.
+  void addHopDetails(Ptr<const Packet> packet, double link_load, const std::vector<double> &window_caps,
+                     uint64_t queue_cap, uint32_t at_node);
   void addReceptionDetails(Ptr<const Packet> packet, uint32_t at_node);
-  void debugTraceElement(Ptr<const Packet> packet);
-
-  uint32_t GetSummaryIntervalNs() {
-    return MilliSeconds(100).GetNanoSeconds();
+  // Registers a new probe of this flow and appends its record, returns the
+  // probe id. Also used by benchmarks to fill the store without sending.
+  uint64_t AppendRecord(uint64_t send_time);
+  // Details of distributed runs, applied by TraceFlowManager::MergeDistributed.
+  void AddDistributedHop(uint32_t seq, double link_load, const double *window_caps, size_t windows,
+                         uint64_t queue_cap, uint32_t at_node);
+  void CompleteDistributedRecord(uint32_t seq, uint32_t at_node, uint64_t receive_time);
+  void debugTraceRecord(Ptr<const Packet> packet);
+
+  uint64_t GetSummaryIntervalNs() {
+    return m_utilizationWindow.GetNanoSeconds();
   }
 
   void WriteResults (QueueAccumulationMethod mode);
+  void WriteResults ();
+
+  // Sends one probe now, used by a TraceProbeScheduler shared by all
+  // senders of a node instead of the per-sender probe timer.
+  void SendProbe ();
+  void UseSharedTimer () { m_sharedTimer = true; }
+
+  // Delays (us) of all rows written to the last trace file.
+  const DelayHistogram& GetRunDelays () const { return m_runDelays; }
+
+  // Records not written yet, and the unanswered probes among them that are
+  // still within the loss timeout.
+  size_t GetLiveRecords () const { return m_records.Size (); }
+  uint64_t GetInFlightProbes () const;
 
 protected:
   virtual void DoDispose (void);
@@ -113,11 +144,39 @@ private:
   void StartSending ();
   void StopSending ();
   void SendPacket ();
+  void SendShadowProbe ();
 
   // Delay (ns), Jitter (ns), min_link_usage (bps), max_link_usage (bps), queue_cap, hops, drop_ratio 
   typedef std::tuple<uint64_t, uint64_t, double, double, uint64_t, uint32_t, double> TraceLogLine;
 
-  std::map<uint64_t, Ptr<TraceElement>> m_trace_map{};
+  TraceRecord* getRecord(Ptr<const Packet> packet);
+  void AddHop (uint32_t seq, double link_load, const double *window_caps, size_t windows,
+               uint64_t queue_cap, uint32_t at_node);
+  void CompleteRecord (TraceRecord &record, uint32_t at_node, uint64_t receive_time);
+
+  std::string GetTraceFileName () const;
+  void OpenTraceFile ();
+  void CloseTraceFile ();
+  bool IsTraceFileOpen () const { return m_traceFile || m_binaryTrace.IsOpen(); }
+  void WriteBlock (size_t first, size_t count, QueueAccumulationMethod mode);
+  void FinalizeBlocks (bool force);
+
+  TraceRecordStore m_records;
+  FILE*           m_traceFile {nullptr}; //!< CSV output file while writing results
+  TraceFileWriter m_binaryTrace;         //!< Binary output file while writing results
+  TraceOutputFormat m_outputFormat;      //!< Format of the trace file
+  std::vector<bool> m_routeWritten;      //!< Routes already in the binary route dictionary
+  DelayHistogram  m_blockDelays;         //!< Delays of the block being written
+  DelayHistogram  m_runDelays;           //!< Delays of all blocks written so far
+  bool            m_stream;              //!< Emit summary rows while the simulation runs
+  uint32_t        m_lossTimeout;         //!< Time after which unanswered probes count as lost (ms)
+  QueueAccumulationMethod m_queueMode;   //!< Queue accumulation used for streamed rows
+  Time            m_utilizationWindow;   //!< Window of the per hop link load
+  std::vector<uint64_t> m_capacityWindows; //!< Windows of the link_cap_<window> columns (ns)
+  std::vector<double> m_hopCapacities;   //!< Per window capacities of a shadow probe hop
+  TraceProbeMode  m_probeMode;           //!< Inject probe packets or sample the path analytically
+  bool            m_sharedTimer {false}; //!< Probes are triggered by a TraceProbeScheduler
+  bool            m_running {false};     //!< Between StartApplication and StopApplication
 
   uint32_t        m_fromNode;
   uint32_t        m_toNode;
@@ -138,7 +197,7 @@ private:
   TypeId          m_tid;          //!< Type of the socket used
   uint32_t        m_seq {0};      //!< Sequence
   bool            m_enableSeqTsSizeHeader {false}; //!< Enable or disable the use of SeqTsSizeHeader
-  uint16_t        m_flowId;
+  uint32_t        m_flowId;
 
   TracedCallback<Ptr<const Packet> > m_txTrace;
   TracedCallback<Ptr<const Packet>, const Address &, const Address &> m_txTraceWithAddresses;
@@ -150,6 +209,25 @@ private:
   void ConnectionFailed (Ptr<Socket> socket);
 };
 
+// Hop of a probe as logged in distributed runs, applied by the owner in
+// time order.
+struct TraceDistributedHop {
+  uint64_t packet_id;
+  uint64_t time;        //!< Simulation time (ns)
+  double link_load;
+  double window_capacity[TraceRecordStore::RECORD_WINDOWS];
+  uint64_t queue_cap;
+  uint32_t node;
+  uint32_t padding;
+};
+
+struct TraceDistributedReception {
+  uint64_t packet_id;
+  uint64_t time;        //!< Simulation time (us)
+  uint32_t node;
+  uint32_t padding;
+};
+
 class TraceFlowManager {
 public:
   static TraceFlowManager& GetInstance() {
@@ -157,43 +235,91 @@ public:
     return instance;
   }
 
-  uint16_t RegisterTraceSender(TraceSender *sender) {
-    uint16_t id = flow_counter++;
-    flow_map[id] = sender;
-    return id;
+  // Probe ids carry their flow in the upper bits and a per-flow sequence in
+  // the lower bits, so the owning sender is recovered without a lookup table.
+  static const uint32_t PROBE_SEQ_BITS = 32;
+
+  static uint64_t MakeProbeId(uint32_t flow, uint32_t seq) {
+    return (static_cast<uint64_t>(flow) << PROBE_SEQ_BITS) | seq;
   }
 
-  uint16_t RegisterTracePacket(uint16_t src) {
-    uint64_t packet = packet_counter++;
-    packet_map[packet] = src;
-    return packet;
+  static uint32_t ProbeIdToFlow(uint64_t packet_id) {
+    return static_cast<uint32_t>(packet_id >> PROBE_SEQ_BITS);
   }
 
-  TraceSender *PacketToTraceSender(uint64_t packet_id) {
-    if (packet_map.count(packet_id) == 0) {
-      return 0;
-    }
+  static uint32_t ProbeIdToSeq(uint64_t packet_id) {
+    return static_cast<uint32_t>(packet_id);
+  }
 
-    uint16_t handler = packet_map.at(packet_id);
+  // Flow ids carry the MPI rank of their sender in the upper bits, so ids
+  // are unique across ranks and every rank knows the owner of a probe.
+  static const uint32_t FLOW_INDEX_BITS = 24;
+  static const uint32_t FLOW_INDEX_MASK = (1u << FLOW_INDEX_BITS) - 1;
 
-    if (flow_map.count(handler) == 0) {
-      return 0;
-    }
+  static uint32_t FlowToRank(uint32_t flow) {
+    return flow >> FLOW_INDEX_BITS;
+  }
+
+  uint32_t RegisterTraceSender(TraceSender *sender) {
+    TraceContext::Attach();
+    uint32_t index = flow_table.size();
+    NS_ABORT_MSG_IF(index > FLOW_INDEX_MASK, "TraceFlowManager: Flow id space exhausted!");
+    flow_table.push_back({sender, 1});
+    return (rank << FLOW_INDEX_BITS) | index;
+  }
+
+  uint64_t RegisterTracePacket(uint32_t src) {
+    FlowSlot &slot = flow_table[src & FLOW_INDEX_MASK];
+    NS_ABORT_MSG_IF(slot.next_seq == 0, "TraceFlowManager: Probe sequence space of flow " << src << " exhausted!");
+    return MakeProbeId(src, slot.next_seq++);
+  }
 
-    return flow_map.at(handler);
+  TraceSender *PacketToTraceSender(uint64_t packet_id) {
+    uint32_t flow = ProbeIdToFlow(packet_id);
+    if (FlowToRank(flow) != rank) return 0;
+    uint32_t index = flow & FLOW_INDEX_MASK;
+    return index < flow_table.size() ? flow_table[index].sender : 0;
   }
 
+  // Distributed runs log hop and reception details of every probe on the
+  // rank where they happen, MergeDistributed hands them to the owning
+  // senders once the simulation is done. Must be enabled before any
+  // TraceSender is created.
+  void EnableDistributed(uint32_t system_id, uint32_t system_count);
+  bool IsDistributed() const { return distributed; }
+  uint64_t GetDistributedWindowNs() const { return distributed_window; }
+  void LogHop(uint64_t packet_id, double link_load, const std::vector<double> &window_caps,
+              uint64_t queue_cap, uint32_t at_node);
+  void LogReception(uint64_t packet_id, uint32_t at_node);
+  // Collective over all ranks, call after Simulator::Run and before WriteResults.
+  void MergeDistributed();
+
   TraceSender *GetTraceSender(Ptr<const Packet> packet);
   void DebugTracePacket(Ptr<const Packet> packet);
+  // Sums of GetLiveRecords and GetInFlightProbes over all senders.
+  void CountRecords(uint64_t& records, uint64_t& in_flight) const;
+  // Forgets all senders and leaves distributed mode, see TraceContext.
+  void Reset();
 private:
-  TraceFlowManager() {}
+  TraceFlowManager() : flow_table(1, FlowSlot{0, 1}), rank(0), ranks(1), distributed(false), distributed_window(0) {}
   TraceFlowManager(const TraceFlowManager&) = delete;
   TraceFlowManager& operator=(const TraceFlowManager) = delete;
 
-  uint16_t flow_counter = 1;
-  uint64_t packet_counter = 1;
-  std::map<uint16_t, TraceSender *> flow_map{};
-  std::map<uint64_t, uint16_t> packet_map{};
+  struct FlowSlot {
+    TraceSender *sender;
+    uint32_t next_seq;
+  };
+
+  // Dense flow table indexed by the local part of the flow id, slot 0 is
+  // reserved for untagged packets.
+  std::vector<FlowSlot> flow_table;
+
+  uint32_t rank;
+  uint32_t ranks;
+  bool distributed;
+  uint64_t distributed_window;  //!< Utilization window of logged hops (ns)
+  std::vector<TraceDistributedHop> hop_log;
+  std::vector<TraceDistributedReception> reception_log;
 };
 
 class TracePathManager {
@@ -203,36 +329,97 @@ public:
     return instance;
   }
 
+  static const uint64_t PATH_HASH_SEED = 1469598103934665603ULL;
+
+  static uint64_t ExtendPathHash(uint64_t hash, uint64_t node) {
+    hash ^= std::hash<uint64_t>()(node);
+    hash *= 1099511628211ULL;
+    return hash;
+  }
+
+  // ExtendPathHash that remembers the prefix, so GetPathNodes can rebuild
+  // the nodes of a path from its hash alone.
+  uint64_t ExtendPath(uint64_t hash, uint32_t node) {
+    uint64_t next = ExtendPathHash(hash, node);
+    if (prefixes.try_emplace(next, PathPrefix{hash, node}).second) {
+      TraceContext::Attach();
+    }
+    return next;
+  }
+
+  // Nodes of a path built with ExtendPath, first node first.
+  std::vector<uint32_t> GetPathNodes(uint64_t hash) const {
+    std::vector<uint32_t> nodes;
+    for (auto it = prefixes.find(hash); it != prefixes.end(); it = prefixes.find(it->second.parent)) {
+      nodes.push_back(it->second.node);
+    }
+    std::reverse(nodes.begin(), nodes.end());
+    return nodes;
+  }
+
+  // Nodes of a route, empty for ids that were never completed with a path.
+  const std::vector<uint32_t>& GetRoutePath(uint16_t id) const {
+    static const std::vector<uint32_t> empty;
+    return id < id_to_path.size() ? id_to_path[id] : empty;
+  }
+
+  bool HasRoutePath(uint16_t id) const {
+    return id < id_to_path.size() && !id_to_path[id].empty();
+  }
+
+  void SetRoutePath(uint16_t id, const std::vector<uint32_t>& nodes) {
+    TraceContext::Attach();
+    if (id >= id_to_path.size()) {
+      id_to_path.resize(id + 1);
+    }
+    id_to_path[id] = nodes;
+  }
+
   uint16_t GetOrCreateRouteId(const std::vector<uint64_t>& path) {
-    uint64_t hash = HashPath(path);
+    return GetOrCreateRouteIdFromHash(HashPath(path));
+  }
 
+  uint16_t GetOrCreateRouteIdFromHash(uint64_t hash) {
     auto it = path_to_id.find(hash);
     if (it != path_to_id.end()) {
         return it->second;
     }
 
+    TraceContext::Attach();
     uint16_t new_id = next_id++;
     if (new_id == 0) new_id = next_id++;
 
     path_to_id[hash] = new_id;
     return new_id;
   }
+
+  void Reset() {
+    path_to_id.clear();
+    id_to_path.clear();
+    prefixes.clear();
+    next_id = 1;
+  }
 private:
   TracePathManager() : next_id(1) {}
   TracePathManager(const TracePathManager&) = delete;
   TracePathManager& operator=(const TracePathManager) = delete;
 
   uint64_t HashPath(const std::vector<uint64_t>& path) const {
-    std::hash<uint64_t> hasher;
-    uint64_t h = 1469598103934665603ULL;
-      for (auto v : path) {
-        h ^= hasher(v);
-        h *= 1099511628211ULL;
-      }
-      return h;
+    uint64_t h = PATH_HASH_SEED;
+    for (auto v : path) {
+      h = ExtendPathHash(h, v);
     }
+    return h;
+  }
+
+  struct PathPrefix {
+    uint64_t parent;  //!< Hash of the path without the last node
+    uint32_t node;
+  };
 
   std::unordered_map<uint64_t, uint16_t> path_to_id;
+  std::vector<std::vector<uint32_t>> id_to_path;
+  std::unordered_map<uint64_t, PathPrefix> prefixes;
   uint16_t next_id;
 };
 
@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <chrono>
+#include <algorithm>
 #include <deque>
 
 #define MONITOR_NODE -1
@@ -38,18 +39,81 @@ void BusyTimeTracker::StopTransmission() {
         }
 
         uint64_t duration = now - lastStartTime;
-        busyPeriods.push_back({now, duration});
-        busyTime += duration;
+        if (mode == BUCKETED) {
+            for (auto& ring : rings) {
+                ring.add(lastStartTime, now);
+            }
+        } else {
+            busyPeriods.push_back({now, duration});
+            busyTime += duration;
+            for (auto& cursor : cursors) {
+                cursor.busy += duration;
+            }
+        }
         running = false;
     }
 }
 
 double BusyTimeTracker::getBusyRatio(uint64_t trackingWindow) {
-    cleanUpOldEntries(trackingWindow);
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    return toRatio(static_cast<double>(busyWithin(now, trackingWindow)), trackingWindow, now);
+}
+
+void BusyTimeTracker::getBusyRatios(std::vector<double>& ratios) {
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    ratios.resize(windows.size());
+
+    if (mode == BUCKETED) {
+        for (size_t i = 0; i < windows.size(); i++) {
+            ratios[i] = toRatio(static_cast<double>(busyWithin(now, windows[i])), windows[i], now);
+        }
+        return;
+    }
+
+    advanceCursors(now);
+    for (size_t i = 0; i < windows.size(); i++) {
+        size_t cursor = std::lower_bound(tracked.begin(), tracked.end(), windows[i]) - tracked.begin();
+        ratios[i] = toRatio(static_cast<double>(cursors[cursor].busy), windows[i], now);
+    }
+}
+
+uint64_t BusyTimeTracker::busyWithin(uint64_t now, uint64_t trackingWindow) {
+    if (mode == BUCKETED) {
+        // The finest ring that still covers the window answers it.
+        for (auto& ring : rings) {
+            if (ring.horizon >= trackingWindow) {
+                return ring.sum(now, trackingWindow);
+            }
+        }
+
+        // Only allocates the first time a longer window is asked for.
+        rings.back().grow(trackingWindow);
+        return rings.back().sum(now, trackingWindow);
+    }
+
+    size_t cursor = trackWindow(trackingWindow);
+    advanceCursors(now);
+    return cursors[cursor].busy;
+}
+
+size_t BusyTimeTracker::trackWindow(uint64_t window) {
+    auto it = std::lower_bound(tracked.begin(), tracked.end(), window);
+    size_t index = it - tracked.begin();
+    if (it != tracked.end() && *it == window) {
+        return index;
+    }
+
+    // A new window starts at the cursor of the next longer one, or at the
+    // oldest kept period if it is the longest, the next advance moves it.
+    WindowCursor cursor = index < cursors.size() ? cursors[index] : WindowCursor{evicted, busyTime};
+    tracked.insert(it, window);
+    cursors.insert(cursors.begin() + index, cursor);
+    return index;
+}
 
-    double real_busy_time = static_cast<double>(busyTime);
+double BusyTimeTracker::toRatio(double real_busy_time, uint64_t trackingWindow, uint64_t now) const {
     if (running) {
-        real_busy_time += Simulator::Now().GetNanoSeconds() - lastStartTime;
+        real_busy_time += now - lastStartTime;
     }
 
     if (real_busy_time > trackingWindow) {
@@ -64,13 +128,24 @@ double BusyTimeTracker::getBusyRatio(uint64_t trackingWindow) {
     return real_busy_time / trackingWindow;
 }
 
-void BusyTimeTracker::cleanUpOldEntries(uint64_t trackingWindow) {
-    uint64_t now = Simulator::Now().GetNanoSeconds();
-    while (!busyPeriods.empty()) {
-        uint64_t delay = now - busyPeriods.front().timestamp;
-        if (delay < trackingWindow) break;
+void BusyTimeTracker::advanceCursors(uint64_t now) {
+    // Every period passes each cursor once, a query costs O(windows)
+    // amortized.
+    uint64_t end = evicted + busyPeriods.size();
+    for (size_t i = 0; i < tracked.size(); i++) {
+        WindowCursor& cursor = cursors[i];
+        while (cursor.index < end) {
+            const BusyPeriod& period = busyPeriods[cursor.index - evicted];
+            if (now - period.timestamp < tracked[i]) break;
+            cursor.busy -= period.durationNs;
+            cursor.index++;
+        }
+    }
+
+    while (evicted < cursors.back().index) {
         busyTime -= busyPeriods.front().durationNs;
         busyPeriods.pop_front();
+        evicted++;
     }
 }
 
@@ -78,4 +153,127 @@ void BusyTimeTracker::setNode(Ptr<Node> node) {
     m_owner = node;
 }
 
+void BusyTimeTracker::setMode(TrackingMode trackingMode) {
+    mode = trackingMode;
+    reset();
+}
+
+void BusyTimeTracker::setBucketWidth(uint64_t widthNs) {
+    NS_ABORT_MSG_IF(widthNs == 0, "BusyTimeTracker: Bucket width must be positive!");
+    bucketWidth = widthNs;
+    reset();
+}
+
+void BusyTimeTracker::setWindows(const std::vector<uint64_t>& windowsNs) {
+    NS_ABORT_MSG_IF(windowsNs.empty(), "BusyTimeTracker: At least one utilization window is required!");
+    windows = windowsNs;
+    std::sort(windows.begin(), windows.end());
+    windows.erase(std::unique(windows.begin(), windows.end()), windows.end());
+    NS_ABORT_MSG_IF(windows.front() == 0, "BusyTimeTracker: Utilization windows must be positive!");
+    reset();
+}
+
+void BusyTimeTracker::reset() {
+    busyPeriods.clear();
+    busyTime = 0;
+    evicted = 0;
+    tracked = windows;
+    cursors.assign(tracked.size(), WindowCursor{0, 0});
+    rings.clear();
+    if (mode != BUCKETED) {
+        return;
+    }
+
+    // Every window keeps the bucket count of the shortest one, windows that
+    // end up with the same bucket width share a ring.
+    uint64_t now = Simulator::Now().GetNanoSeconds();
+    for (uint64_t window : windows) {
+        uint64_t width = std::max<uint64_t>(1, bucketWidth * (window / windows.front()));
+        if (!rings.empty() && rings.back().width == width) {
+            rings.back().grow(window);
+        } else {
+            rings.emplace_back(width, window, now);
+        }
+    }
+}
+
+BusyTimeTracker::BucketRing::BucketRing(uint64_t widthNs, uint64_t horizonNs, uint64_t now)
+    : width(widthNs),
+      horizon(horizonNs),
+      headBucket(now / widthNs),
+      // One extra bucket for the partially covered oldest bucket of a window.
+      buckets((horizonNs + widthNs - 1) / widthNs + 1, 0) {}
+
+void BusyTimeTracker::BucketRing::advance(uint64_t bucket) {
+    if (bucket <= headBucket) {
+        return;
+    }
+
+    uint64_t size = buckets.size();
+    if (bucket - headBucket >= size) {
+        std::fill(buckets.begin(), buckets.end(), 0);
+    } else {
+        for (uint64_t b = headBucket + 1; b <= bucket; b++) {
+            buckets[b % size] = 0;
+        }
+    }
+    headBucket = bucket;
+}
+
+void BusyTimeTracker::BucketRing::add(uint64_t start, uint64_t end) {
+    advance(end / width);
+
+    uint64_t size = buckets.size();
+    uint64_t oldest = headBucket >= size - 1 ? headBucket - (size - 1) : 0;
+    uint64_t first = std::max(start / width, oldest);
+
+    // Split the busy period at the bucket boundaries it crosses.
+    for (uint64_t b = first; b <= headBucket; b++) {
+        uint64_t from = std::max(start, b * width);
+        uint64_t to = std::min(end, (b + 1) * width);
+        if (to > from) {
+            buckets[b % size] += to - from;
+        }
+    }
+}
+
+void BusyTimeTracker::BucketRing::grow(uint64_t horizonNs) {
+    uint64_t count = (horizonNs + width - 1) / width + 1;
+    horizon = std::max(horizon, horizonNs);
+    if (count <= buckets.size()) {
+        return;
+    }
+
+    std::vector<uint64_t> grown(count, 0);
+    uint64_t size = buckets.size();
+    for (uint64_t age = 0; age < size && age <= headBucket; age++) {
+        grown[(headBucket - age) % count] = buckets[(headBucket - age) % size];
+    }
+    buckets.swap(grown);
+}
+
+uint64_t BusyTimeTracker::BucketRing::sum(uint64_t now, uint64_t trackingWindow) const {
+    uint64_t windowStart = now > trackingWindow ? now - trackingWindow : 0;
+    uint64_t startBucket = windowStart / width;
+    uint64_t size = buckets.size();
+
+    // Buckets beyond the ring head have not seen any busy time yet.
+    uint64_t last = std::min(now / width, headBucket);
+    if (headBucket >= size && startBucket < headBucket - size + 1) {
+        startBucket = headBucket - size + 1;
+    }
+
+    uint64_t busy_sum = 0;
+    for (uint64_t b = startBucket; b <= last && last >= startBucket; b++) {
+        uint64_t busy = buckets[b % size];
+        uint64_t bucketStart = b * width;
+        if (bucketStart < windowStart) {
+            // Only the covered share of the oldest bucket counts.
+            busy = busy * (bucketStart + width - windowStart) / width;
+        }
+        busy_sum += busy;
+    }
+    return busy_sum;
+}
+
 }
@@ -6,18 +6,39 @@
 #include "ns3/internet-module.h"
 
 #include <deque>
+#include <vector>
 
 namespace ns3 {
 
 class BusyTimeTracker : public Object {
 public:
-    BusyTimeTracker() : busyTime(0), running(false), logId(0) {}
+    /**
+     * EXACT keeps the busy periods of the longest window in a deque, with a
+     * cursor and running sum per configured or queried window. BUCKETED
+     * accumulates busy
+     * time in rings of fixed-width time buckets and splits periods at
+     * bucket boundaries. Each configured window is answered by one ring.
+     */
+    enum TrackingMode {
+        EXACT,
+        BUCKETED
+    };
+
+    BusyTimeTracker() : busyTime(0), running(false), logId(0), evicted(0), mode(EXACT),
+                        bucketWidth(100000), windows({100000000}), tracked(windows),
+                        cursors(1, WindowCursor{0, 0}) {}
 
     void StartTransmission();
     void StopTransmission();
     double getBusyRatio(uint64_t trackingWindow);
+    void getBusyRatios(std::vector<double>& ratios);
     void setNode(Ptr<Node> node);
 
+    void setMode(TrackingMode trackingMode);
+    void setBucketWidth(uint64_t widthNs);
+    void setWindows(const std::vector<uint64_t>& windowsNs);
+    const std::vector<uint64_t>& getWindows() const { return windows; }
+
     static ns3::TypeId GetTypeId() {
     static ns3::TypeId tid = ns3::TypeId("BusyTimeTracker");
     return tid;
@@ -32,14 +53,56 @@ private:
         uint64_t durationNs;
     };
 
+    /**
+     * First busy period (absolute index, counting evicted ones) that ended
+     * within a window, and the busy time from there to the newest period.
+     */
+    struct WindowCursor {
+        uint64_t index;
+        uint64_t busy;
+    };
+
+    /**
+     * Ring of busy time buckets covering one horizon. Buckets past the
+     * ring head have not seen busy time yet, older ones are overwritten.
+     */
+    struct BucketRing {
+        uint64_t width;
+        uint64_t horizon;
+        uint64_t headBucket;            //!< Absolute index (time / width) of the newest bucket
+        std::vector<uint64_t> buckets;  //!< Busy nanoseconds per bucket, indexed modulo size
+
+        BucketRing(uint64_t widthNs, uint64_t horizonNs, uint64_t now);
+        void advance(uint64_t bucket);
+        void add(uint64_t start, uint64_t end);
+        void grow(uint64_t horizonNs);
+        uint64_t sum(uint64_t now, uint64_t trackingWindow) const;
+    };
+
     uint64_t busyTime;
     bool running;
     uint64_t lastStartTime;
     uint64_t logId;
     Ptr<Node> m_owner;
     std::deque<BusyPeriod> busyPeriods;
+    uint64_t evicted;               //!< Absolute index of busyPeriods.front()
+
+    TrackingMode mode;
+    uint64_t bucketWidth;           //!< Bucket width of the shortest window
+    std::vector<uint64_t> windows;  //!< Configured windows, ascending
+    std::vector<BucketRing> rings;  //!< One ring per distinct bucket width, finest first
+    std::vector<uint64_t> tracked;      //!< Windows with a cursor in EXACT mode, ascending
+    std::vector<WindowCursor> cursors;  //!< One per tracked window
+
+    // Index of the cursor of a window, a new one is added on first use.
+    size_t trackWindow(uint64_t window);
 
-    void cleanUpOldEntries(uint64_t trackingWindow);
+    // Moves the cursors past periods that left their window, then evicts
+    // the periods before the cursor of the longest window.
+    void advanceCursors(uint64_t now);
+    void reset();
+    uint64_t busyWithin(uint64_t now, uint64_t trackingWindow);
+    double toRatio(double real_busy_time, uint64_t trackingWindow, uint64_t now) const;
 };
 
 }
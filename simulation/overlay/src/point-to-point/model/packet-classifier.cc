@@ -0,0 +1,28 @@
+#include "packet-classifier.h"
+
+#include "ns3/trace-sender-application.h"
+#include "ns3/tcp-speedtest-sender.h"
+
+namespace ns3 {
+
+PacketClassifier::PacketClassifier()
+  : m_cache(1ULL << CACHE_BITS, CacheEntry{UINT64_MAX, NONE}),
+    m_cacheEnabled(true),
+    m_traceTag(TracePacketTag::GetTypeId()),
+    m_speedtestTag(SpeedtestTag::GetTypeId()) {}
+
+uint8_t PacketClassifier::Scan(Ptr<const Packet> packet) const {
+    uint8_t flags = NONE;
+    ByteTagIterator it = packet->GetByteTagIterator();
+    while (it.HasNext()) {
+        TypeId tid = it.Next().GetTypeId();
+        if (tid == m_traceTag) {
+            flags |= TRACE_PROBE;
+        } else if (tid == m_speedtestTag) {
+            flags |= SPEEDTEST;
+        }
+    }
+    return flags;
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef PACKET_CLASSIFIER_H
+#define PACKET_CLASSIFIER_H
+
+#include "ns3/packet.h"
+#include "ns3/ptr.h"
+#include "ns3/type-id.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * Caches which instrumentation tags a packet carries, keyed by packet UID.
+ *
+ * The byte tag list of a packet is scanned once for all known tag types,
+ * later lookups of the same packet (at the same or any following hop) are
+ * answered from a direct-mapped table. Copies of a packet share its UID, so
+ * the entry stays valid across forwarding. Collisions only cause a rescan.
+ */
+class PacketClassifier {
+public:
+  enum Flags : uint8_t {
+    NONE = 0,
+    TRACE_PROBE = 1 << 0,
+    SPEEDTEST = 1 << 1
+  };
+
+  static PacketClassifier& GetInstance() {
+    static PacketClassifier instance;
+    return instance;
+  }
+
+  uint8_t Classify(Ptr<const Packet> packet) {
+    if (!m_cacheEnabled) return Scan(packet);
+    uint64_t uid = packet->GetUid();
+    CacheEntry &entry = m_cache[uid & CACHE_MASK];
+    if (entry.uid != uid) {
+      entry.uid = uid;
+      entry.flags = Scan(packet);
+    }
+    return entry.flags;
+  }
+
+  // UIDs are only unique within one process, distributed runs scan always.
+  void SetCacheEnabled(bool enabled) {
+    m_cacheEnabled = enabled;
+  }
+
+  // Drops all cached entries and enables the cache again.
+  void Reset() {
+    std::fill(m_cache.begin(), m_cache.end(), CacheEntry{UINT64_MAX, NONE});
+    m_cacheEnabled = true;
+  }
+
+private:
+  PacketClassifier();
+  PacketClassifier(const PacketClassifier&) = delete;
+  PacketClassifier& operator=(const PacketClassifier) = delete;
+
+  uint8_t Scan(Ptr<const Packet> packet) const;
+
+  struct CacheEntry {
+    uint64_t uid;
+    uint8_t flags;
+  };
+
+  static const uint32_t CACHE_BITS = 14;
+  static const uint64_t CACHE_MASK = (1ULL << CACHE_BITS) - 1;
+
+  std::vector<CacheEntry> m_cache;
+  bool m_cacheEnabled;
+  TypeId m_traceTag;
+  TypeId m_speedtestTag;
+};
+
+}
+
+#endif // PACKET_CLASSIFIER_H
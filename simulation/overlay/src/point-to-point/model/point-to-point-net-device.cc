@@ -9,6 +9,7 @@
 #include "point-to-point-channel.h"
 #include "ppp-header.h"
 
+#include "ns3/enum.h"
 #include "ns3/error-model.h"
 #include "ns3/llc-snap-header.h"
 #include "ns3/log.h"
@@ -16,10 +17,15 @@
 #include "ns3/pointer.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
+#include "ns3/string.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 #include "ns3/trace-sender-helper.h"
 #include "ns3/tcp-speedtest-sender.h"
+#include "packet-classifier.h"
+
+#include <algorithm>
+#include <sstream>
 
 namespace ns3
 {
@@ -62,6 +68,29 @@ PointToPointNetDevice::GetTypeId()
                           TimeValue(Seconds(0)),
                           MakeTimeAccessor(&PointToPointNetDevice::m_tInterframeGap),
                           MakeTimeChecker())
+            .AddAttribute("UtilizationTracking",
+                          "How the busy time of the device is tracked for utilization queries",
+                          EnumValue(BusyTimeTracker::EXACT),
+                          MakeEnumAccessor<BusyTimeTracker::TrackingMode>(
+                              &PointToPointNetDevice::SetUtilizationTracking,
+                              &PointToPointNetDevice::GetUtilizationTracking),
+                          MakeEnumChecker(BusyTimeTracker::EXACT,
+                                          "Exact",
+                                          BusyTimeTracker::BUCKETED,
+                                          "Bucketed"))
+            .AddAttribute("UtilizationBucketWidth",
+                          "Width of a time bucket in bucketed utilization tracking",
+                          TimeValue(MicroSeconds(100)),
+                          MakeTimeAccessor(&PointToPointNetDevice::SetUtilizationBucketWidth,
+                                           &PointToPointNetDevice::GetUtilizationBucketWidth),
+                          MakeTimeChecker())
+            .AddAttribute("UtilizationWindows",
+                          "Comma separated utilization windows answered together by "
+                          "GetDeviceUtilizations, e.g. \"10ms,100ms,1s\"",
+                          StringValue("100ms"),
+                          MakeStringAccessor(&PointToPointNetDevice::SetUtilizationWindows,
+                                             &PointToPointNetDevice::GetUtilizationWindows),
+                          MakeStringChecker())
 
             //
             // Transmit queueing discipline for the device which includes its own set
@@ -169,7 +198,10 @@ PointToPointNetDevice::PointToPointNetDevice()
     : m_txMachineState(READY),
       m_channel(nullptr),
       m_linkUp(false),
-      m_currentPkt(nullptr)
+      m_currentPkt(nullptr),
+      m_currentTracer(nullptr),
+      m_currentProbe(0),
+      m_utilizationMode(BusyTimeTracker::EXACT)
 {
     NS_LOG_FUNCTION(this);
     utilization_tracker = Create<BusyTimeTracker>();
@@ -179,6 +211,85 @@ double PointToPointNetDevice::GetDeviceUtilization(uint64_t trackingWindow) {
     return (1 - utilization_tracker->getBusyRatio(trackingWindow)) * m_bps.GetBitRate();
 }
 
+void PointToPointNetDevice::GetDeviceUtilizations(std::vector<double>& utilizations) {
+    utilization_tracker->getBusyRatios(utilizations);
+    for (double& utilization : utilizations) {
+        utilization = (1 - utilization) * m_bps.GetBitRate();
+    }
+}
+
+Time
+PointToPointNetDevice::GetBacklogDelay() const
+{
+    Time backlog = Seconds(0);
+    if (m_txMachineState == BUSY && m_txEndTime > Simulator::Now())
+    {
+        backlog += m_txEndTime - Simulator::Now();
+    }
+    backlog += m_bps.CalculateBytesTxTime(m_queue->GetNBytes());
+    backlog += TimeStep(m_tInterframeGap.GetTimeStep() * m_queue->GetNPackets());
+    return backlog;
+}
+
+void
+PointToPointNetDevice::SetUtilizationTracking(BusyTimeTracker::TrackingMode mode)
+{
+    m_utilizationMode = mode;
+    utilization_tracker->setMode(mode);
+}
+
+BusyTimeTracker::TrackingMode
+PointToPointNetDevice::GetUtilizationTracking() const
+{
+    return m_utilizationMode;
+}
+
+void
+PointToPointNetDevice::SetUtilizationBucketWidth(Time width)
+{
+    m_utilizationBucketWidth = width;
+    utilization_tracker->setBucketWidth(width.GetNanoSeconds());
+}
+
+Time
+PointToPointNetDevice::GetUtilizationBucketWidth() const
+{
+    return m_utilizationBucketWidth;
+}
+
+void
+PointToPointNetDevice::SetUtilizationWindows(std::string windows)
+{
+    m_utilizationWindows = windows;
+    utilization_tracker->setWindows(ParseUtilizationWindows(windows));
+}
+
+std::vector<uint64_t>
+PointToPointNetDevice::ParseUtilizationWindows(const std::string& windows)
+{
+    std::vector<uint64_t> windowsNs;
+    std::stringstream ss(windows);
+    std::string window;
+    while (std::getline(ss, window, ','))
+    {
+        window.erase(0, window.find_first_not_of(" \t"));
+        window.erase(window.find_last_not_of(" \t") + 1);
+        if (!window.empty())
+        {
+            windowsNs.push_back(Time(window).GetNanoSeconds());
+        }
+    }
+    std::sort(windowsNs.begin(), windowsNs.end());
+    windowsNs.erase(std::unique(windowsNs.begin(), windowsNs.end()), windowsNs.end());
+    return windowsNs;
+}
+
+std::string
+PointToPointNetDevice::GetUtilizationWindows() const
+{
+    return m_utilizationWindows;
+}
+
 PointToPointNetDevice::~PointToPointNetDevice()
 {
     NS_LOG_FUNCTION(this);
@@ -245,20 +356,51 @@ PointToPointNetDevice::TransmitStart(Ptr<Packet> p)
     m_currentPkt = p;
     m_phyTxBeginTrace(m_currentPkt);
 
+    //
+    // Untagged cross traffic is the common case, classify once and only do
+    // the tracer lookups for packets that actually carry one of their tags.
+    //
+    uint8_t pktClass = PacketClassifier::GetInstance().Classify(m_currentPkt);
+    m_currentTracer = nullptr;
+    m_currentProbe = 0;
+    if (pktClass & PacketClassifier::TRACE_PROBE) {
+        TraceFlowManager& flows = TraceFlowManager::GetInstance();
+        if (flows.IsDistributed()) {
+            // The sender may live on another rank, log the hop by probe id.
+            TracePacketTag tag;
+            if (m_currentPkt->FindFirstMatchingByteTag(tag)) {
+                m_currentProbe = tag.GetId();
+            }
+        } else {
+            m_currentTracer = flows.GetTraceSender(m_currentPkt);
+        }
+    }
+
     Time txCompleteTime = Seconds(0);
     Time txTime = Seconds(0);
-    if (!TraceFlowManager::GetInstance().GetTraceSender(m_currentPkt)) {
+    if (!m_currentTracer && !m_currentProbe) {
         utilization_tracker->StartTransmission();
         txTime = m_bps.CalculateBytesTxTime (m_currentPkt->GetSize ());
         txCompleteTime = txTime + m_tInterframeGap;
+        m_txEndTime = Simulator::Now() + txCompleteTime;
     }
 
     NS_LOG_LOGIC("Schedule TransmitCompleteEvent in " << txCompleteTime.As(Time::S));
     Simulator::Schedule(txCompleteTime, &PointToPointNetDevice::TransmitComplete, this);
 
-    TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().GetSender(m_currentPkt);
-    if (sender && SpeedtestManager::GetInstance().isPacketFrom(m_currentPkt, m_node->GetId())) {
-        sender->addTransmissionDetails(m_currentPkt, m_node->GetId());
+    if (pktClass & PacketClassifier::SPEEDTEST) {
+        TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().GetSender(m_currentPkt);
+        if (sender && sender->GetNode()->GetId() == m_node->GetId()) {
+            sender->addTransmissionDetails(m_currentPkt, m_node->GetId());
+        }
+    } else if (SpeedtestManager::GetInstance().TracksSegments()) {
+        // Untagged speed test chunks are found by their TCP header.
+        Ptr<Packet> segment = m_currentPkt->Copy();
+        PppHeader ppp;
+        segment->RemoveHeader(ppp);
+        if (PppToEther(ppp.GetProtocol()) == 0x0800) {
+            SpeedtestManager::GetInstance().TrackSegment(segment, m_node->GetId(), true);
+        }
     }
 
     bool result = m_channel->TransmitStart(p, this, txTime);
@@ -287,13 +429,23 @@ PointToPointNetDevice::TransmitComplete()
 
     m_phyTxEndTrace(m_currentPkt);
 
-    TraceSender *sender = TraceFlowManager::GetInstance().GetTraceSender(m_currentPkt);
-    if (!sender) {
-        utilization_tracker->StopTransmission();
-    } else {
+    TraceSender *sender = m_currentTracer;
+    uint64_t probe = m_currentProbe;
+    m_currentTracer = nullptr;
+    m_currentProbe = 0;
+    if (sender) {
         uint64_t queue_free = GetQueue()->GetMaxSize().GetValue() - GetQueue()->GetNPackets();
         double load = GetDeviceUtilization(sender->GetSummaryIntervalNs());
-        sender->addHopDetails(m_currentPkt, load, queue_free, GetNode()->GetId());
+        GetDeviceUtilizations(m_hopCapacities);
+        sender->addHopDetails(m_currentPkt, load, m_hopCapacities, queue_free, GetNode()->GetId());
+    } else if (probe) {
+        TraceFlowManager& flows = TraceFlowManager::GetInstance();
+        uint64_t queue_free = GetQueue()->GetMaxSize().GetValue() - GetQueue()->GetNPackets();
+        double load = GetDeviceUtilization(flows.GetDistributedWindowNs());
+        GetDeviceUtilizations(m_hopCapacities);
+        flows.LogHop(probe, load, m_hopCapacities, queue_free, GetNode()->GetId());
+    } else {
+        utilization_tracker->StopTransmission();
     }
     
 
@@ -385,9 +537,13 @@ PointToPointNetDevice::Receive(Ptr<Packet> packet)
         //
         ProcessHeader(packet, protocol);
 
-        TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().GetSender(packet);
-        if (sender && SpeedtestManager::GetInstance().isPacketTo(packet, m_node->GetId())) {
-            sender->addReceptionDetails(packet, m_node->GetId());
+        if (PacketClassifier::GetInstance().Classify(packet) & PacketClassifier::SPEEDTEST) {
+            TCPSpeedtestSender *sender = SpeedtestManager::GetInstance().GetSender(packet);
+            if (sender && sender->m_receiverId == m_node->GetId()) {
+                sender->addReceptionDetails(packet, m_node->GetId());
+            }
+        } else if (protocol == 0x0800 && SpeedtestManager::GetInstance().TracksSegments()) {
+            SpeedtestManager::GetInstance().TrackSegment(packet, m_node->GetId(), false);
         }
 
 
@@ -422,6 +578,29 @@ PointToPointNetDevice::NotifyLinkUp()
     m_linkChangeCallbacks();
 }
 
+void
+PointToPointNetDevice::SetLinkUp(bool up)
+{
+    NS_LOG_FUNCTION(this << up);
+    if (up == m_linkUp || !m_channel)
+    {
+        return;
+    }
+
+    if (up)
+    {
+        NotifyLinkUp();
+        return;
+    }
+
+    m_linkUp = false;
+    while (Ptr<Packet> packet = m_queue->Dequeue())
+    {
+        m_macTxDropTrace(packet);
+    }
+    m_linkChangeCallbacks();
+}
+
 void
 PointToPointNetDevice::SetIfIndex(const uint32_t index)
 {
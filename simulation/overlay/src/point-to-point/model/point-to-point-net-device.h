@@ -22,12 +22,15 @@
 #include "busytime-tracker.h"
 
 #include <cstring>
+#include <string>
+#include <vector>
 
 namespace ns3
 {
 
 class PointToPointChannel;
 class ErrorModel;
+class TraceSender;
 
 /**
  * @defgroup point-to-point Point-To-Point Network Device
@@ -90,6 +93,17 @@ class PointToPointNetDevice : public NetDevice
      */
     void SetDataRate(DataRate bps);
 
+    /**
+     * Take the link down or bring it back up.
+     *
+     * While down the device refuses new packets. Taking it down drops the
+     * queued packets, a packet already on the wire is still delivered.
+     * Both cases call the linkChange callbacks.
+     *
+     * @param up the new link state
+     */
+    void SetLinkUp(bool up);
+
     /**
      * Set the interframe gap used to separate packets.  The interframe gap
      * defines the minimum space required between packets sent by this device.
@@ -435,6 +449,10 @@ class PointToPointNetDevice : public NetDevice
 
     Ptr<Packet> m_currentPkt; //!< Current packet processed
 
+    TraceSender* m_currentTracer; //!< Trace sender owning m_currentPkt, if it is a probe
+    uint64_t m_currentProbe;      //!< Probe id of m_currentPkt in distributed runs, 0 otherwise
+    Time m_txEndTime;             //!< End of the current cross traffic transmission
+
     /**
      * @brief PPP to Ethernet protocol number mapping
      * @param protocol A PPP protocol number
@@ -451,9 +469,36 @@ class PointToPointNetDevice : public NetDevice
 
   private:
     Ptr<BusyTimeTracker> utilization_tracker;
-  
+    BusyTimeTracker::TrackingMode m_utilizationMode; //!< Busy time tracking mode
+    Time m_utilizationBucketWidth;                   //!< Bucket width of bucketed tracking
+    std::string m_utilizationWindows;                //!< Windows answered by GetDeviceUtilizations
+    std::vector<double> m_hopCapacities;             //!< Per window capacities of the current probe hop
+
   public:
     double GetDeviceUtilization(uint64_t trackingWindow);
+    /**
+     * @brief Available capacity for every configured utilization window
+     * @param utilizations Filled with one value per window, shortest first
+     */
+    void GetDeviceUtilizations(std::vector<double>& utilizations);
+    /**
+     * @brief Time until a packet enqueued now would start transmitting
+     * @return Remaining transmission time plus the drain time of the queue
+     */
+    Time GetBacklogDelay() const;
+
+    void SetUtilizationTracking(BusyTimeTracker::TrackingMode mode);
+    BusyTimeTracker::TrackingMode GetUtilizationTracking() const;
+    void SetUtilizationBucketWidth(Time width);
+    Time GetUtilizationBucketWidth() const;
+    void SetUtilizationWindows(std::string windows);
+    std::string GetUtilizationWindows() const;
+    /**
+     * @brief Parse a UtilizationWindows value
+     * @param windows Comma separated times, e.g. "10ms,100ms,1s"
+     * @return The windows in nanoseconds, ascending and without duplicates
+     */
+    static std::vector<uint64_t> ParseUtilizationWindows(const std::string& windows);
 };
 
 } // namespace ns3